@@ -19,8 +19,14 @@
 */
 
 #include "minimap.h"
+#include "minimapprerenderer.h"
 #include "minimapsettings.h"
 #include "minimapstyle.h"
+#include "minimaptrace.h"
+
+#ifdef WITH_TESTS
+#include "minimap_test.h"
+#endif
 
 #include <coreplugin/editormanager/editormanager.h>
 #include <coreplugin/editormanager/ieditor.h>
@@ -37,6 +43,7 @@ MinimapPlugin::MinimapPlugin() {}
 
 MinimapPlugin::~MinimapPlugin()
 {
+    MinimapTraceEvents::shutdown();
     MinimapStyle *style = qobject_cast<MinimapStyle *>(qApp->style());
     if (style) {
         qApp->setStyle(style->baseStyle());
@@ -46,9 +53,24 @@ MinimapPlugin::~MinimapPlugin()
 void MinimapPlugin::initialize()
 {
     new MinimapSettings(this);
+    new MinimapPrerenderer(this);
+    MinimapTraceEvents::updateEnabled();
+    connect(MinimapSettings::instance(),
+            &MinimapSettings::traceEventsChanged,
+            this,
+            &MinimapTraceEvents::updateEnabled);
 
     Core::EditorManager *em = Core::EditorManager::instance();
     connect(em, &Core::EditorManager::editorCreated, this, &MinimapPlugin::editorCreated);
+
+#ifdef WITH_TESTS
+    addTest<MinimapTest>();
+#endif
+}
+
+void MinimapPlugin::extensionsInitialized()
+{
+    MinimapTraceReplay::startIfRequested();
 }
 
 void MinimapPlugin::setupQStyle()
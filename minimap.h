@@ -45,6 +45,7 @@ public:
     ~MinimapPlugin();
 
     void initialize();
+    void extensionsInitialized();
     void setupQStyle();
 
 private:
@@ -0,0 +1,89 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimap_test.h"
+#include "minimapstyle.h"
+
+#include <coreplugin/editormanager/editormanager.h>
+#include <coreplugin/editormanager/ieditor.h>
+#include <texteditor/texteditor.h>
+#include <texteditor/texteditorconstants.h>
+
+#include <QScopeGuard>
+#include <QScrollBar>
+#include <QTest>
+
+#ifdef Q_OS_LINUX
+#include <dlfcn.h>
+#endif
+
+namespace Minimap {
+namespace Internal {
+namespace {
+// lines of the document rendered by the tests
+const int documentLines = 2000;
+
+using AllocationCount = long long (*)();
+
+//! Returns the allocation counter of the calling thread, provided by the
+//! MinimapAllocationCounter library if it was preloaded, or nullptr.
+AllocationCount allocationCounter()
+{
+#ifdef Q_OS_LINUX
+    return reinterpret_cast<AllocationCount>(dlsym(RTLD_DEFAULT, "minimapAllocationCount"));
+#else
+    return nullptr;
+#endif
+}
+} // namespace
+
+void MinimapTest::steadyStateFrameAllocations()
+{
+    const AllocationCount allocations = allocationCounter();
+    if (!allocations) {
+        QSKIP("The MinimapAllocationCounter library is not preloaded");
+    }
+
+    QByteArray contents;
+    for (int i = 0; i < documentLines; ++i) {
+        contents += "    int value" + QByteArray::number(i) + " = compute(value, " + QByteArray::number(i)
+                    + "); // comment\n";
+    }
+    QString title = "minimap-allocations";
+    Core::IEditor *editor
+        = Core::EditorManager::openEditorWithContents(TextEditor::Constants::K_DEFAULT_TEXT_EDITOR_ID,
+                                                      &title,
+                                                      contents);
+    auto textEditor = qobject_cast<TextEditor::BaseTextEditor *>(editor);
+    QVERIFY(textEditor);
+    const auto closeEditor = qScopeGuard(
+        [editor] { Core::EditorManager::closeEditors({editor}, false); });
+    const QScrollBar *scrollbar = textEditor->editorWidget()->verticalScrollBar();
+
+    // the first frames fill the row cache and grow the scratch buffers
+    QTRY_VERIFY(MinimapStyle::renderFrame(scrollbar));
+    QVERIFY(MinimapStyle::renderFrame(scrollbar));
+
+    const long long before = allocations();
+    QVERIFY(MinimapStyle::renderFrame(scrollbar));
+    QCOMPARE(allocations() - before, 0);
+}
+} // namespace Internal
+} // namespace Minimap
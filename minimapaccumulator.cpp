@@ -0,0 +1,115 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimapaccumulator.h"
+
+#include <algorithm>
+
+namespace Minimap {
+namespace Internal {
+namespace {
+// fraction bits of the reciprocals used for averaging
+const int fractionBits = 16;
+} // namespace
+
+void MinimapRowAccumulator::reset(int width, EMinimapDownsampling policy, QRgb background)
+{
+    m_width = qMax(0, width);
+    m_policy = policy;
+    m_background = background;
+    m_red.assign(m_width, 0);
+    m_green.assign(m_width, 0);
+    m_blue.assign(m_width, 0);
+    m_ink.assign(m_width, 0);
+    m_row.resize(m_width);
+    m_extent = 0;
+    m_lines = 0;
+    m_weight = 0;
+}
+
+void MinimapRowAccumulator::add(const QRgb *row, int extent)
+{
+    ++m_lines;
+    if (m_policy == EMinimapDownsampling::eRepresentative && m_weight > 0) {
+        // only the first line of a pixel row counts
+        return;
+    }
+    ++m_weight;
+    extent = qMin(extent, m_width);
+    m_extent = qMax(m_extent, extent);
+    quint32 *red = m_red.data();
+    quint32 *green = m_green.data();
+    quint32 *blue = m_blue.data();
+    quint32 *ink = m_ink.data();
+    // branch free, so the compiler can vectorize it: ink is opaque, blank
+    // pixels are fully transparent
+    for (int x = 0; x < extent; ++x) {
+        const quint32 pixel = row[x];
+        const quint32 inked = pixel >> 31;
+        red[x] += ((pixel >> 16) & 0xff) * inked;
+        green[x] += ((pixel >> 8) & 0xff) * inked;
+        blue[x] += (pixel & 0xff) * inked;
+        ink[x] += inked;
+    }
+}
+
+const QRgb *MinimapRowAccumulator::resolve(int &extent)
+{
+    const quint32 weight = static_cast<quint32>(qMax(1, m_weight));
+    const quint32 reciprocal = ((1u << fractionBits) + weight / 2) / weight;
+    const quint32 half = 1u << (fractionBits - 1);
+    const quint32 bgRed = qRed(m_background);
+    const quint32 bgGreen = qGreen(m_background);
+    const quint32 bgBlue = qBlue(m_background);
+    for (int x = 0; x < m_extent; ++x) {
+        const quint32 ink = m_ink[x];
+        if (ink == 0) {
+            m_row[x] = m_background & 0x00ffffff;
+            continue;
+        }
+        quint32 red = m_red[x];
+        quint32 green = m_green[x];
+        quint32 blue = m_blue[x];
+        if (m_policy == EMinimapDownsampling::eMaxInk) {
+            // the average color of the ink, at full strength
+            red /= ink;
+            green /= ink;
+            blue /= ink;
+        } else {
+            // the ink weighted with its coverage against the background
+            const quint32 blank = weight - ink;
+            red = ((bgRed * blank + red) * reciprocal + half) >> fractionBits;
+            green = ((bgGreen * blank + green) * reciprocal + half) >> fractionBits;
+            blue = ((bgBlue * blank + blue) * reciprocal + half) >> fractionBits;
+        }
+        m_row[x] = qRgb(qMin(red, 255u), qMin(green, 255u), qMin(blue, 255u));
+    }
+    std::fill(m_red.begin(), m_red.begin() + m_extent, 0);
+    std::fill(m_green.begin(), m_green.begin() + m_extent, 0);
+    std::fill(m_blue.begin(), m_blue.begin() + m_extent, 0);
+    std::fill(m_ink.begin(), m_ink.begin() + m_extent, 0);
+    extent = m_extent;
+    m_extent = 0;
+    m_lines = 0;
+    m_weight = 0;
+    return m_row.data();
+}
+} // namespace Internal
+} // namespace Minimap
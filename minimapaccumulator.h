@@ -0,0 +1,65 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include "minimapconstants.h"
+
+#include <QRgb>
+
+#include <vector>
+
+namespace Minimap {
+namespace Internal {
+
+//! Merges the rows of several lines sharing a pixel row of the minimap.
+//!
+//! The ink and color of every column are summed in integers as rows are
+//! added and normalized once per pixel row, according to the downsampling
+//! policy.
+class MinimapRowAccumulator
+{
+public:
+    void reset(int width, EMinimapDownsampling policy, QRgb background);
+
+    //! Adds a row with @a extent pixels covered by text.
+    void add(const QRgb *row, int extent);
+
+    int lineCount() const { return m_lines; }
+
+    //! Returns the merged row, valid until the next call, and starts over.
+    //! @a extent receives the number of pixels covered by text.
+    const QRgb *resolve(int &extent);
+
+private:
+    std::vector<quint32> m_red;
+    std::vector<quint32> m_green;
+    std::vector<quint32> m_blue;
+    std::vector<quint32> m_ink;
+    std::vector<QRgb> m_row;
+    EMinimapDownsampling m_policy = EMinimapDownsampling::eAverage;
+    QRgb m_background = 0;
+    int m_width = 0;
+    int m_extent = 0;
+    int m_lines = 0;  //!< lines added since the last resolve
+    int m_weight = 0; //!< lines summed since the last resolve
+};
+} // namespace Internal
+} // namespace Minimap
@@ -29,7 +29,26 @@ namespace Minimap {
 enum class EMinimapStyle
 {
     eScaling,
-    eScrolling
+    eScrolling,
+    eStructural //!< like eScaling, drawing structure only when zoomed out far
+};
+
+//! How the lines sharing a pixel row of a scaled minimap are merged.
+enum class EMinimapDownsampling
+{
+    eAverage,       //!< ink averaged with its coverage
+    eMaxInk,        //!< any ink at full strength
+    eRepresentative //!< only the first line of the row
+};
+
+//! Level of detail the minimap is rendered with, chosen by the render governor.
+enum class EMinimapDetail
+{
+    eFull,    //!< every character in its highlighted color, at device resolution
+    eLogical, //!< like eFull, but at logical resolution on high DPI screens
+    eRuns,    //!< runs of ink in the text color
+    eDensity, //!< one bar per line
+    eNone     //!< plain scrollbar
 };
 
 namespace Constants {
@@ -42,7 +61,18 @@ const int MINIMAP_MAX_LINE_COUNT_DEFAULT = 8000;
 const int MINIMAP_ALPHA_DEFAULT = 32;
 const bool MINIMAP_CENTER_ON_CLICK_DEFAULT = true;
 const bool MINIMAP_SHOW_LINE_TOOLTIP_DEFAULT = true;
+const bool MINIMAP_SHOW_HOVER_LENS_DEFAULT = true;
 const int MINIMAP_PIXELS_PER_LINE_DEFAULT = 2;
 const EMinimapStyle MINIMAP_STYLE_DEFAULT = EMinimapStyle::eScrolling;
+const int MINIMAP_STRUCTURAL_SCALE_DEFAULT = 50; // %
+const bool MINIMAP_COMPRESS_LONG_LINES_DEFAULT = false;
+const EMinimapDownsampling MINIMAP_DOWNSAMPLING_DEFAULT = EMinimapDownsampling::eAverage;
+const int MINIMAP_DISK_CACHE_SIZE_DEFAULT = 64; // MiB
+const int MINIMAP_PRERENDER_MEMORY_DEFAULT = 32; // MiB
+const int MINIMAP_RENDER_BUDGET_DEFAULT = 10; // ms
+const bool MINIMAP_TRACE_EVENTS_DEFAULT = false;
+const char MINIMAP_TRACE_RECORD_ENV[] = "QTC_MINIMAP_TRACE_RECORD";
+const char MINIMAP_TRACE_REPLAY_ENV[] = "QTC_MINIMAP_TRACE_REPLAY";
+const char MINIMAP_TRACE_EVENTS_ENV[] = "QTC_MINIMAP_TRACE_EVENTS";
 } // namespace Constants
 } // namespace Minimap
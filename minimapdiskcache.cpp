@@ -0,0 +1,261 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimapdiskcache.h"
+#include "minimaprowcache.h"
+#include "minimapsettings.h"
+
+#include <coreplugin/icore.h>
+#include <utils/filepath.h>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include <cstring>
+
+namespace Minimap {
+namespace Internal {
+namespace {
+const quint32 magic = 0x4d4d4150; // "MMAP"
+const quint32 version = 4;
+// rows compressed together, a band is the smallest part of an entry decoded
+const int bandRows = 256;
+
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    quint32 key;
+    quint32 contentHash;
+    qint32 width;
+    qint32 rowCount;
+};
+
+struct RowEntry
+{
+    quint32 textHash;
+    qint32 extent; //!< negative for rows that were not stored
+};
+
+struct BandEntry
+{
+    quint64 offset; //!< from the start of the file
+    quint64 size;   //!< of the compressed pixels
+};
+
+int bandCount(int rowCount)
+{
+    return (rowCount + bandRows - 1) / bandRows;
+}
+
+QString cacheDirectory()
+{
+    return Core::ICore::userResourcePath("minimap").toFSPathString();
+}
+
+QString cacheFileName(const Utils::FilePath &filePath)
+{
+    const QByteArray hash = QCryptographicHash::hash(filePath.toString().toUtf8(),
+                                                     QCryptographicHash::Sha1);
+    return cacheDirectory() + '/' + QString::fromLatin1(hash.toHex()) + ".cache";
+}
+
+bool readHeader(QFile &file, Header &header)
+{
+    return file.read(reinterpret_cast<char *>(&header), sizeof(Header)) == sizeof(Header)
+           && header.magic == magic && header.version == version;
+}
+
+void prune(qint64 maximumSize)
+{
+    QDir dir(cacheDirectory());
+    const QFileInfoList entries = dir.entryInfoList({"*.cache"}, QDir::Files, QDir::Time);
+    qint64 size = 0;
+    for (const QFileInfo &entry : entries) {
+        size += entry.size();
+        if (size > maximumSize) {
+            QFile::remove(entry.absoluteFilePath());
+        }
+    }
+}
+} // namespace
+
+MinimapDiskCacheRows::~MinimapDiskCacheRows()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+    }
+}
+
+bool MinimapDiskCacheRows::read(int source, QRgb *row)
+{
+    if (source < 0 || source >= m_rowCount) {
+        return false;
+    }
+    const int band = source / bandRows;
+    if (band != m_decodedBand) {
+        const qint64 bandsOffset = qint64(sizeof(Header)) + qint64(m_rowCount) * sizeof(RowEntry);
+        BandEntry entry;
+        std::memcpy(&entry, m_data + bandsOffset + qint64(band) * sizeof(BandEntry), sizeof(BandEntry));
+        const int rows = qMin(bandRows, m_rowCount - band * bandRows);
+        m_decodedBand = -1;
+        if (entry.offset > quint64(m_size) || entry.size > quint64(m_size) - entry.offset) {
+            return false;
+        }
+        m_decoded = qUncompress(m_data + entry.offset, static_cast<qsizetype>(entry.size));
+        if (m_decoded.size() != qsizetype(rows) * m_width * qsizetype(sizeof(QRgb))) {
+            return false;
+        }
+        m_decodedBand = band;
+    }
+    std::memcpy(row,
+                m_decoded.constData() + qsizetype(source % bandRows) * m_width * sizeof(QRgb),
+                m_width * sizeof(QRgb));
+    return true;
+}
+
+std::unique_ptr<MinimapDiskCacheRows> MinimapDiskCache::load(const Utils::FilePath &filePath,
+                                                             uint key,
+                                                             MinimapRowCache &rows)
+{
+    if (MinimapSettings::diskCacheSize() <= 0 || filePath.isEmpty() || rows.rowCount() == 0) {
+        return nullptr;
+    }
+    std::unique_ptr<MinimapDiskCacheRows> entry(new MinimapDiskCacheRows);
+    QFile &file = entry->m_file;
+    file.setFileName(cacheFileName(filePath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+    Header header;
+    if (!readHeader(file, header) || header.key != key || header.width != rows.width()
+        || header.rowCount != rows.rowCount()) {
+        return nullptr;
+    }
+    const qint64 tableSize = qint64(header.rowCount) * sizeof(RowEntry)
+                             + qint64(bandCount(header.rowCount)) * sizeof(BandEntry);
+    entry->m_size = file.size();
+    if (entry->m_size < qint64(sizeof(Header)) + tableSize) {
+        return nullptr;
+    }
+    // the pixels stay in the file until a row is used
+    entry->m_data = file.map(0, entry->m_size);
+    if (!entry->m_data) {
+        return nullptr;
+    }
+    entry->m_width = header.width;
+    entry->m_rowCount = header.rowCount;
+    const RowEntry *entries = reinterpret_cast<const RowEntry *>(entry->m_data + sizeof(Header));
+    bool seeded(false);
+    for (int i = 0; i < header.rowCount; ++i) {
+        if (entries[i].extent >= 0) {
+            rows.setSeeded(i, entries[i].textHash, entries[i].extent, i);
+            seeded = true;
+        }
+    }
+    if (!seeded) {
+        return nullptr;
+    }
+    // keep track of the last use for pruning
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return entry;
+}
+
+bool MinimapDiskCache::isStored(const Utils::FilePath &filePath,
+                                uint key,
+                                const MinimapRowCache &rows,
+                                uint contentHash)
+{
+    QFile existing(cacheFileName(filePath));
+    if (!existing.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    Header header;
+    if (readHeader(existing, header) && header.key == key && header.width == rows.width()
+        && header.rowCount == rows.rowCount() && header.contentHash == contentHash) {
+        existing.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        return true;
+    }
+    return false;
+}
+
+void MinimapDiskCache::store(const Utils::FilePath &filePath,
+                             uint key,
+                             const MinimapRowCache &rows,
+                             const QList<uint> &textHashes,
+                             const QList<bool> &kept,
+                             uint contentHash)
+{
+    const int maximumSize = MinimapSettings::diskCacheSize();
+    if (maximumSize <= 0 || filePath.isEmpty() || rows.rowCount() == 0
+        || textHashes.size() != rows.rowCount() || kept.size() != rows.rowCount()) {
+        return;
+    }
+    // nothing to do if the entry is still up to date
+    if (isStored(filePath, key, rows, contentHash)) {
+        return;
+    }
+
+    QDir().mkpath(cacheDirectory());
+    Header header{magic, version, key, contentHash, rows.width(), rows.rowCount()};
+    QList<RowEntry> entries;
+    entries.reserve(rows.rowCount());
+    for (int i = 0; i < rows.rowCount(); ++i) {
+        entries.append(RowEntry{textHashes.at(i), kept.at(i) ? rows.extent(i) : -1});
+    }
+    // every band is compressed on its own, so it can be decoded on its own
+    const int bands = bandCount(rows.rowCount());
+    QList<QByteArray> pixels;
+    QList<BandEntry> bandEntries;
+    pixels.reserve(bands);
+    bandEntries.reserve(bands);
+    quint64 offset = sizeof(Header) + qsizetype(entries.size()) * sizeof(RowEntry)
+                     + qsizetype(bands) * sizeof(BandEntry);
+    for (int band = 0; band < bands; ++band) {
+        const int first = band * bandRows;
+        const int count = qMin(bandRows, rows.rowCount() - first);
+        pixels.append(qCompress(
+            QByteArray::fromRawData(reinterpret_cast<const char *>(rows.row(first)),
+                                    qsizetype(count) * rows.width() * sizeof(QRgb))));
+        bandEntries.append(BandEntry{offset, quint64(pixels.last().size())});
+        offset += pixels.last().size();
+    }
+
+    QSaveFile file(cacheFileName(filePath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char *>(entries.constData()),
+               qsizetype(entries.size()) * sizeof(RowEntry));
+    file.write(reinterpret_cast<const char *>(bandEntries.constData()),
+               qsizetype(bandEntries.size()) * sizeof(BandEntry));
+    for (const QByteArray &band : std::as_const(pixels)) {
+        file.write(band);
+    }
+    if (file.commit()) {
+        prune(qint64(maximumSize) * 1024 * 1024);
+    }
+}
+} // namespace Internal
+} // namespace Minimap
@@ -0,0 +1,99 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QRgb>
+
+#include <memory>
+
+namespace Utils {
+class FilePath;
+}
+
+namespace Minimap {
+namespace Internal {
+class MinimapRowCache;
+
+//! The pixels of a cache entry seeded into a row cache. The entry stays
+//! mapped and is compressed in bands of rows that are decoded on their own,
+//! so only the bands of rows that are actually used get decompressed.
+class MinimapDiskCacheRows
+{
+public:
+    ~MinimapDiskCacheRows();
+
+    //! Copies row @a source of the entry into @a row. Returns false if its
+    //! band cannot be decoded.
+    bool read(int source, QRgb *row);
+
+private:
+    friend class MinimapDiskCache;
+    MinimapDiskCacheRows() = default;
+
+    QFile m_file;
+    uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    int m_width = 0;
+    int m_rowCount = 0;
+    int m_decodedBand = -1;
+    QByteArray m_decoded;
+};
+
+//! Persistent cache of rendered minimap rows, stored below the user's
+//! Qt Creator settings directory.
+//!
+//! Entries are keyed by the file path of the document and a key covering
+//! everything else the rendering depends on (font, theme, minimap
+//! settings). Every row carries the hash of its block's text so restored
+//! rows can be validated lazily, when they are first used.
+class MinimapDiskCache
+{
+public:
+    //! Seeds @a rows from the cache entry of @a filePath if its key, width and
+    //! row count match. Only the text hashes and extents are read, the pixels
+    //! of a seeded row are read from the returned entry when it is used.
+    //! Returns nullptr if no rows were seeded.
+    static std::unique_ptr<MinimapDiskCacheRows> load(const Utils::FilePath &filePath,
+                                                      uint key,
+                                                      MinimapRowCache &rows);
+
+    //! Returns true if the entry of @a filePath already holds @a rows with
+    //! the content @a contentHash, marking it as recently used.
+    static bool isStored(const Utils::FilePath &filePath,
+                         uint key,
+                         const MinimapRowCache &rows,
+                         uint contentHash);
+
+    //! Stores @a rows for @a filePath and prunes the cache to its maximum size.
+    //! Only the rows flagged in @a kept are restored by load(). Any
+    //! MinimapDiskCacheRows of @a filePath must be gone by then.
+    static void store(const Utils::FilePath &filePath,
+                      uint key,
+                      const MinimapRowCache &rows,
+                      const QList<uint> &textHashes,
+                      const QList<bool> &kept,
+                      uint contentHash);
+};
+} // namespace Internal
+} // namespace Minimap
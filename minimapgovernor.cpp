@@ -0,0 +1,100 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimapgovernor.h"
+#include "minimapsettings.h"
+
+namespace Minimap {
+namespace Internal {
+namespace {
+// consecutive frames over budget before the detail is reduced
+const int framesOverBudgetLimit = 3;
+// consecutive frames with headroom before the detail is raised
+const int framesWithHeadroomLimit = 30;
+// fraction of the budget a frame has to stay below to count as headroom
+const int headroomDivisor = 4;
+// time to wait after a change before raising the detail again
+const qint64 stepUpDelay = 5000;
+// time after which a switched off minimap is tried again
+const qint64 probeInterval = 10000;
+} // namespace
+
+MinimapGovernor::MinimapGovernor()
+    : m_detail(EMinimapDetail::eFull)
+    , m_framesOverBudget(0)
+    , m_framesWithHeadroom(0)
+{
+    m_sinceChange.start();
+}
+
+bool MinimapGovernor::addFrame(qint64 nsecs)
+{
+    const qint64 budget = qint64(MinimapSettings::renderBudget()) * 1000000;
+    if (budget <= 0) {
+        if (m_detail == EMinimapDetail::eFull) {
+            return false;
+        }
+        setDetail(EMinimapDetail::eFull);
+        return true;
+    }
+
+    if (nsecs > budget) {
+        m_framesWithHeadroom = 0;
+        if (++m_framesOverBudget >= framesOverBudgetLimit && m_detail != EMinimapDetail::eNone) {
+            setDetail(static_cast<EMinimapDetail>(static_cast<int>(m_detail) + 1));
+            return true;
+        }
+    } else if (nsecs < budget / headroomDivisor) {
+        m_framesOverBudget = 0;
+        if (++m_framesWithHeadroom >= framesWithHeadroomLimit
+            && m_detail != EMinimapDetail::eFull && m_sinceChange.elapsed() > stepUpDelay) {
+            setDetail(static_cast<EMinimapDetail>(static_cast<int>(m_detail) - 1));
+            return true;
+        }
+    } else {
+        m_framesOverBudget = 0;
+        m_framesWithHeadroom = 0;
+    }
+    return false;
+}
+
+bool MinimapGovernor::probe()
+{
+    if (m_detail != EMinimapDetail::eNone || m_sinceChange.elapsed() < probeInterval) {
+        return false;
+    }
+    setDetail(EMinimapDetail::eDensity);
+    return true;
+}
+
+void MinimapGovernor::reset()
+{
+    setDetail(EMinimapDetail::eFull);
+}
+
+void MinimapGovernor::setDetail(EMinimapDetail detail)
+{
+    m_detail = detail;
+    m_framesOverBudget = 0;
+    m_framesWithHeadroom = 0;
+    m_sinceChange.restart();
+}
+} // namespace Internal
+} // namespace Minimap
@@ -0,0 +1,60 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include "minimapconstants.h"
+
+#include <QElapsedTimer>
+
+namespace Minimap {
+namespace Internal {
+
+//! Chooses the level of detail of one minimap from its measured render times.
+//!
+//! The detail is stepped down when frames repeatedly exceed the render time
+//! budget, and stepped up again after a while of frames well within it. A
+//! minimap that was switched off entirely cannot be measured, it is probed
+//! at a lower detail again once the probe interval has passed.
+class MinimapGovernor
+{
+public:
+    MinimapGovernor();
+
+    EMinimapDetail detail() const { return m_detail; }
+
+    //! Records a frame that took @a nsecs. Returns true if the detail changed.
+    bool addFrame(qint64 nsecs);
+
+    //! Returns true if a switched off minimap should be tried again.
+    bool probe();
+
+    void reset();
+
+private:
+    void setDetail(EMinimapDetail detail);
+
+    EMinimapDetail m_detail;
+    int m_framesOverBudget;
+    int m_framesWithHeadroom;
+    QElapsedTimer m_sinceChange;
+};
+} // namespace Internal
+} // namespace Minimap
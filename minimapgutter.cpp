@@ -0,0 +1,131 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimapgutter.h"
+
+#include "minimapmirror.h"
+
+#include <QColor>
+
+#include <algorithm>
+
+namespace Minimap {
+namespace Internal {
+namespace {
+const QRgb black = QColor(Qt::black).rgb();
+const QRgb red = QColor(Qt::red).rgb();
+const QRgb green = QColor(Qt::darkGreen).rgb();
+
+//! Draws a two pixel wide gutter marker starting at logical column @a x.
+inline void fillMarker(QRgb *line, int x, int width, int scale, QRgb color)
+{
+    std::fill(line + qMin(width, x * scale), line + qMin(width, (x + 2) * scale), color);
+}
+} // namespace
+
+bool MinimapGutterLayer::sync(const MinimapSnapshot &snapshot,
+                              bool revisionsVisible,
+                              bool foldingVisible)
+{
+    const int lineCount = snapshot.lineCount();
+    bool changed(false);
+    if (m_states.size() != lineCount) {
+        m_states.fill(0, lineCount);
+        m_markedCount = 0;
+        invalidateAll();
+        changed = true;
+    }
+    return sync(snapshot, revisionsVisible, foldingVisible, 0, lineCount - 1) || changed;
+}
+
+bool MinimapGutterLayer::sync(const MinimapSnapshot &snapshot,
+                              bool revisionsVisible,
+                              bool foldingVisible,
+                              int first,
+                              int last)
+{
+    if (m_states.size() != snapshot.lineCount()) {
+        // lines were inserted or removed without being followed
+        return sync(snapshot, revisionsVisible, foldingVisible);
+    }
+    bool changed(false);
+    last = qMin(last, snapshot.lineCount() - 1);
+    for (int n = qMax(0, first); n <= last; ++n) {
+        const MinimapMirrorLine &line = snapshot.line(n);
+        quint8 state(0);
+        if (revisionsVisible && line.revision != snapshot.lastSaveRevision) {
+            state |= line.revision < 0 ? Saved : Modified;
+        }
+        if (foldingVisible && (line.flags & MinimapMirrorLine::Folded)) {
+            state |= Folded;
+        }
+        quint8 &current = m_states[n];
+        if (current != state) {
+            m_markedCount += (state != 0) - (current != 0);
+            current = state;
+            invalidateBlock(n);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void MinimapGutterLayer::blocksChanged(int first, int delta)
+{
+    if (first < 0) {
+        // the change could not be located, the next sync starts over
+        m_states.clear();
+        return;
+    }
+    if (delta == 0 || m_states.isEmpty() || first >= m_states.size()) {
+        return;
+    }
+    if (delta > 0) {
+        m_states.insert(first + 1, delta, 0);
+    } else {
+        const int count = qMin(-delta, int(m_states.size()) - first - 1);
+        for (int n = first + 1; n <= first + count; ++n) {
+            m_markedCount -= m_states.at(n) != 0;
+        }
+        m_states.remove(first + 1, count);
+    }
+    invalidateAll();
+}
+
+bool MinimapGutterLayer::drawBlock(int block, QRgb *line, int width, int scale)
+{
+    const quint8 state = block < m_states.size() ? m_states.at(block) : 0;
+    if (state == 0) {
+        return false;
+    }
+    // blocks blended into one band share it, a modification wins over a
+    // saved change
+    if (state & Modified) {
+        fillMarker(line, 1, width, scale, red);
+    } else if ((state & Saved) && qAlpha(line[scale]) == 0) {
+        fillMarker(line, 1, width, scale, green);
+    }
+    if (state & Folded) {
+        fillMarker(line, 4, width, scale, black);
+    }
+    return true;
+}
+} // namespace Internal
+} // namespace Minimap
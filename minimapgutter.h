@@ -0,0 +1,69 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include "minimaplayer.h"
+
+#include <QList>
+
+namespace Minimap {
+namespace Internal {
+
+struct MinimapSnapshot;
+
+//! Draws the revision and fold markers into the gutter left of the text.
+//!
+//! The state of every line is kept, so saving or folding only redraws the
+//! gutter bands of the lines whose markers changed.
+class MinimapGutterLayer : public MinimapLayer
+{
+public:
+    //! Updates the state of every line from @a snapshot. Returns true if
+    //! any of them changed.
+    bool sync(const MinimapSnapshot &snapshot, bool revisionsVisible, bool foldingVisible);
+    //! Updates the state of the lines @a first to @a last from @a snapshot.
+    //! Returns true if any of them changed.
+    bool sync(const MinimapSnapshot &snapshot,
+              bool revisionsVisible,
+              bool foldingVisible,
+              int first,
+              int last);
+
+    //! Moves the states of the lines following @a first by @a delta lines
+    //! as they were inserted or removed behind it.
+    void blocksChanged(int first, int delta);
+
+protected:
+    bool hasContent() const override { return m_markedCount > 0; }
+    bool drawBlock(int block, QRgb *line, int width, int scale) override;
+
+private:
+    enum State : quint8 {
+        Saved = 0x01,    //!< changed and saved since the document was opened
+        Modified = 0x02, //!< changed since the last save
+        Folded = 0x04
+    };
+
+    QList<quint8> m_states;
+    int m_markedCount = 0;
+};
+} // namespace Internal
+} // namespace Minimap
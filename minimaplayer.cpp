@@ -0,0 +1,161 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimaplayer.h"
+
+#include <QPainter>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Minimap {
+namespace Internal {
+
+bool MinimapLayer::update(const MinimapLayout &layout, const QSize &size, qreal dpr)
+{
+    if (m_image.size() != size || m_image.devicePixelRatio() != dpr) {
+        m_image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+        m_image.setDevicePixelRatio(dpr);
+        m_full = true;
+    }
+    if (!(m_layout == layout)) {
+        m_layout.assign(layout);
+        m_full = true;
+    }
+    if (!hasContent()) {
+        // nothing to draw, redraw everything once there is
+        const bool wasVisible = m_visible;
+        m_visible = false;
+        m_full = true;
+        m_dirty.clear();
+        return wasVisible;
+    }
+    if (!m_full && m_dirty.isEmpty()) {
+        return false;
+    }
+    m_scratch.resize(m_image.width());
+    m_visible = true;
+
+    const QList<int> &tops = m_layout.tops;
+    const int blockCount = static_cast<int>(tops.size());
+    if (m_full) {
+        m_full = false;
+        m_dirty.clear();
+        m_image.fill(Qt::transparent);
+        for (int i = 0; i < blockCount;) {
+            const int top = tops.at(i);
+            if (top == MinimapLayout::hidden) {
+                ++i;
+                continue;
+            }
+            int last = i;
+            while (last + 1 < blockCount
+                   && (tops.at(last + 1) == top || tops.at(last + 1) == MinimapLayout::hidden)) {
+                ++last;
+            }
+            drawBand(top, i, last);
+            i = last + 1;
+        }
+        upload(true);
+        return true;
+    }
+
+    std::sort(m_dirty.begin(), m_dirty.end());
+    int drawnTop = MinimapLayout::hidden;
+    for (int block : std::as_const(m_dirty)) {
+        if (block < 0 || block >= blockCount) {
+            continue;
+        }
+        const int top = tops.at(block);
+        if (top == MinimapLayout::hidden || top == drawnTop) {
+            continue;
+        }
+        // blended blocks share their band, all of them have to be redrawn
+        int first = block;
+        while (first > 0
+               && (tops.at(first - 1) == top || tops.at(first - 1) == MinimapLayout::hidden)) {
+            --first;
+        }
+        int last = block;
+        while (last + 1 < blockCount
+               && (tops.at(last + 1) == top || tops.at(last + 1) == MinimapLayout::hidden)) {
+            ++last;
+        }
+        drawBand(top, first, last);
+        drawnTop = top;
+    }
+    m_dirty.clear();
+    upload(false);
+    return true;
+}
+
+void MinimapLayer::clear()
+{
+    m_image = QImage();
+    m_pixmap = QPixmap();
+    m_drawnBands.clear();
+    m_layout = MinimapLayout();
+    m_dirty.clear();
+    m_full = true;
+    m_visible = false;
+}
+
+void MinimapLayer::drawBand(int top, int first, int last)
+{
+    const int width = m_image.width();
+    QRgb *line = m_scratch.data();
+    std::fill(line, line + width, 0);
+    for (int i = first; i <= last; ++i) {
+        if (m_layout.tops.at(i) == top) {
+            drawBlock(i, line, width, m_layout.scale);
+        }
+    }
+    const int begin = qMax(0, top);
+    const int end = qMin(m_image.height(), top + m_layout.bandHeight);
+    for (int y = begin; y < end; ++y) {
+        memcpy(m_image.scanLine(y), line, width * sizeof(QRgb));
+    }
+    if (begin < end) {
+        m_drawnBands.append({begin, end});
+    }
+}
+
+void MinimapLayer::upload(bool full)
+{
+    if (full || m_pixmap.size() != m_image.size()
+        || m_pixmap.devicePixelRatio() != m_image.devicePixelRatio()) {
+        m_pixmap = QPixmap::fromImage(m_image);
+        m_drawnBands.clear();
+        return;
+    }
+    if (m_drawnBands.isEmpty()) {
+        return;
+    }
+    QPainter painter(&m_pixmap);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    const qreal dpr = m_image.devicePixelRatio();
+    for (const auto &[begin, end] : std::as_const(m_drawnBands)) {
+        const QRect source(0, begin, m_image.width(), end - begin);
+        painter.drawImage(QRectF(source.topLeft() / dpr, source.size() / dpr), m_image, source);
+    }
+    m_drawnBands.clear();
+}
+} // namespace Internal
+} // namespace Minimap
@@ -0,0 +1,117 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include <QImage>
+#include <QList>
+#include <QPixmap>
+#include <QRgb>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace Minimap {
+namespace Internal {
+
+//! Where the blocks of the last rendered frame ended up in the minimap image.
+struct MinimapLayout
+{
+    static constexpr int hidden = std::numeric_limits<int>::min();
+
+    void reset(int blockCount, int bandHeight, int scale)
+    {
+        tops.fill(hidden, blockCount);
+        this->bandHeight = bandHeight;
+        this->scale = scale;
+    }
+
+    //! Copies @a other into the buffer of this layout instead of sharing
+    //! the one of @a other, which would detach on its next reset().
+    void assign(const MinimapLayout &other)
+    {
+        tops.resize(other.tops.size());
+        std::copy(other.tops.cbegin(), other.tops.cend(), tops.begin());
+        bandHeight = other.bandHeight;
+        scale = other.scale;
+    }
+
+    bool operator==(const MinimapLayout &other) const
+    {
+        return bandHeight == other.bandHeight && scale == other.scale && tops == other.tops;
+    }
+
+    QList<int> tops;    //!< first image row of each block, or hidden
+    int bandHeight = 1; //!< image rows of a block
+    int scale = 1;      //!< device pixels per logical pixel
+};
+
+//! A layer composited on top of the minimap text.
+//!
+//! Layers keep their own image and draw it block by block, using the layout
+//! of the last rendered frame. Only the bands of invalidated blocks are
+//! redrawn, unless the layout or the size of the minimap changed. The image
+//! is mirrored into a pixmap the same way, band by band, so painting the
+//! layer does not convert or upload anything.
+class MinimapLayer
+{
+public:
+    virtual ~MinimapLayer() = default;
+
+    const QImage &image() const { return m_image; }
+    const QPixmap &pixmap() const { return m_pixmap; }
+
+    //! Returns true if the layer has anything to composite.
+    bool isVisible() const { return !m_image.isNull() && m_visible; }
+
+    void invalidateBlock(int block) { m_dirty.append(block); }
+    void invalidateAll() { m_full = true; }
+
+    //! Brings the image up to date. Returns true if it changed.
+    bool update(const MinimapLayout &layout, const QSize &size, qreal dpr);
+
+    void clear();
+
+protected:
+    virtual bool hasContent() const = 0;
+
+    //! Draws @a block into @a line, a scan line of @a width device pixels.
+    //! Returns true if anything was drawn.
+    virtual bool drawBlock(int block, QRgb *line, int width, int scale) = 0;
+
+private:
+    //! Draws the band starting at @a top, made of the blocks @a first to
+    //! @a last that start there.
+    void drawBand(int top, int first, int last);
+    //! Copies the bands drawn since the last upload into the pixmap.
+    void upload(bool full);
+
+    QImage m_image;
+    QPixmap m_pixmap;
+    QList<std::pair<int, int>> m_drawnBands; //!< scan line ranges
+    MinimapLayout m_layout;
+    QList<int> m_dirty;
+    std::vector<QRgb> m_scratch;
+    bool m_full = true;
+    bool m_visible = false;
+};
+} // namespace Internal
+} // namespace Minimap
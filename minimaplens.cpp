@@ -0,0 +1,70 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimaplens.h"
+
+#include <QPainter>
+#include <QScreen>
+
+namespace Minimap {
+namespace Internal {
+namespace {
+// width of the frame around the preview
+const int borderWidth = 1;
+} // namespace
+
+MinimapLens::MinimapLens(QWidget *parent)
+    : QWidget(parent, Qt::ToolTip | Qt::FramelessWindowHint)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_ShowWithoutActivating);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void MinimapLens::showImage(const QImage &image, const QPoint &globalPos)
+{
+    m_image = image;
+    const QSize size = image.deviceIndependentSize().toSize()
+                       + QSize(2 * borderWidth, 2 * borderWidth);
+    QRect geometry(QPoint(globalPos.x() - size.width(), globalPos.y() - size.height() / 2), size);
+    if (const QScreen *screen = QWidget::screen()) {
+        const QRect available = screen->availableGeometry();
+        geometry.moveTop(qBound(available.top(),
+                                geometry.top(),
+                                qMax(available.top(), available.bottom() - size.height())));
+        geometry.moveLeft(qMax(available.left(), geometry.left()));
+    }
+    if (geometry != this->geometry()) {
+        setGeometry(geometry);
+    }
+    if (!isVisible()) {
+        show();
+    }
+    update();
+}
+
+void MinimapLens::paintEvent(QPaintEvent * /*event*/)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().color(QPalette::Mid));
+    painter.drawImage(QPoint(borderWidth, borderWidth), m_image);
+}
+} // namespace Internal
+} // namespace Minimap
@@ -0,0 +1,49 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include <QImage>
+#include <QWidget>
+
+namespace Minimap {
+namespace Internal {
+
+//! Popup showing a magnified preview of the minimap next to it.
+//!
+//! The lens only displays images handed to it, it never lays out text on
+//! its own.
+class MinimapLens : public QWidget
+{
+public:
+    explicit MinimapLens(QWidget *parent);
+
+    //! Shows @a image with the middle of its right edge at @a globalPos,
+    //! kept on the screen of @a globalPos.
+    void showImage(const QImage &image, const QPoint &globalPos);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QImage m_image;
+};
+} // namespace Internal
+} // namespace Minimap
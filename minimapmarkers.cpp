@@ -0,0 +1,137 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimapmarkers.h"
+
+#include <algorithm>
+
+namespace Minimap {
+namespace Internal {
+namespace {
+// width of the marker strip, in logical pixels
+const int markerWidth = 2;
+} // namespace
+
+bool MinimapMarkerLayer::apply(const QList<MinimapMarkerChange> &changes)
+{
+    bool changed(false);
+    for (const MinimapMarkerChange &change : changes) {
+        switch (change.type) {
+        case MinimapMarkerChange::Add:
+            changed |= add(change.block, change.marker);
+            break;
+        case MinimapMarkerChange::Remove:
+            changed |= remove(change.block, change.marker.key);
+            break;
+        case MinimapMarkerChange::Update: {
+            const int block = blockOf(change.marker.key);
+            const QList<MinimapMarker> line = m_lines.value(block);
+            const auto it = std::find_if(line.cbegin(), line.cend(), [&](const MinimapMarker &m) {
+                return m.key == change.marker.key;
+            });
+            if (block == change.block && it != line.cend() && *it == change.marker) {
+                break;
+            }
+            if (block >= 0) {
+                remove(block, change.marker.key);
+            }
+            changed |= add(change.block, change.marker);
+            break;
+        }
+        }
+    }
+    return changed;
+}
+
+void MinimapMarkerLayer::blocksChanged(int first, int delta)
+{
+    if (delta == 0 || m_lines.isEmpty() || m_lines.lastKey() <= first) {
+        return;
+    }
+    QMap<int, QList<MinimapMarker>> lines;
+    for (auto it = m_lines.cbegin(); it != m_lines.cend(); ++it) {
+        int block = it.key();
+        if (block > first) {
+            block = delta < 0 && block <= first - delta ? first : block + delta;
+        }
+        lines[block].append(it.value());
+        for (const MinimapMarker &marker : it.value()) {
+            m_blocks.insert(marker.key, block);
+        }
+    }
+    m_lines = lines;
+    invalidateAll();
+}
+
+void MinimapMarkerLayer::clearMarkers()
+{
+    if (!m_lines.isEmpty()) {
+        invalidateAll();
+    }
+    m_lines.clear();
+    m_blocks.clear();
+}
+
+bool MinimapMarkerLayer::drawBlock(int block, QRgb *line, int width, int scale)
+{
+    const auto it = m_lines.constFind(block);
+    if (it == m_lines.cend() || it->isEmpty()) {
+        return false;
+    }
+    const MinimapMarker &top = *std::max_element(it->cbegin(),
+                                                 it->cend(),
+                                                 [](const MinimapMarker &a, const MinimapMarker &b) {
+                                                     return a.priority < b.priority;
+                                                 });
+    const QRgb color = top.color | 0xff000000;
+    std::fill(line + qMax(0, width - markerWidth * scale), line + width, color);
+    return true;
+}
+
+bool MinimapMarkerLayer::add(int block, const MinimapMarker &marker)
+{
+    if (block < 0 || m_blocks.contains(marker.key)) {
+        return false;
+    }
+    m_lines[block].append(marker);
+    m_blocks.insert(marker.key, block);
+    invalidateBlock(block);
+    return true;
+}
+
+bool MinimapMarkerLayer::remove(int block, quintptr key)
+{
+    auto it = m_lines.find(block);
+    if (it == m_lines.end()) {
+        return false;
+    }
+    const qsizetype removed = it->removeIf([key](const MinimapMarker &m) { return m.key == key; });
+    if (removed == 0) {
+        return false;
+    }
+    if (it->isEmpty()) {
+        m_lines.erase(it);
+    }
+    m_blocks.remove(key);
+    invalidateBlock(block);
+    return true;
+}
+} // namespace Internal
+} // namespace Minimap
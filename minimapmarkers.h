@@ -0,0 +1,95 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include "minimaplayer.h"
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QRgb>
+
+namespace Minimap {
+namespace Internal {
+
+//! A marker shown next to a line, like a diagnostic, a bookmark or a
+//! breakpoint. Of several markers of a line the one with the highest
+//! priority is shown.
+struct MinimapMarker
+{
+    quintptr key; //!< identifies the marker across changes
+    QRgb color;
+    int priority;
+
+    bool operator==(const MinimapMarker &other) const
+    {
+        return key == other.key && color == other.color && priority == other.priority;
+    }
+};
+
+struct MinimapMarkerChange
+{
+    enum Type { Add, Remove, Update };
+
+    Type type;
+    int block;
+    MinimapMarker marker; //!< only the key is used by Remove
+};
+
+//! Draws markers at the right edge of the minimap.
+//!
+//! Markers are stored sparsely per block and changed in batches. A batch only
+//! invalidates the blocks it touched, so any number of changes costs a
+//! single redraw of their bands on the next paint.
+class MinimapMarkerLayer : public MinimapLayer
+{
+public:
+    //! Applies @a changes. Returns true if any marker changed.
+    bool apply(const QList<MinimapMarkerChange> &changes);
+
+    //! Returns the block of the marker with @a key, or -1 if there is none.
+    int blockOf(quintptr key) const { return m_blocks.value(key, -1); }
+
+    const QHash<quintptr, int> &blocks() const { return m_blocks; }
+
+    //! Follows @a delta blocks inserted, or removed if negative, after
+    //! block @a first. Markers of removed blocks move to @a first.
+    //!
+    //! Marks that the document moves differently, like on a line break typed
+    //! at the start of a marked line, are corrected by the next sync with
+    //! its marks.
+    void blocksChanged(int first, int delta);
+
+    void clearMarkers();
+
+protected:
+    bool hasContent() const override { return !m_lines.isEmpty(); }
+    bool drawBlock(int block, QRgb *line, int width, int scale) override;
+
+private:
+    bool add(int block, const MinimapMarker &marker);
+    bool remove(int block, quintptr key);
+
+    QMap<int, QList<MinimapMarker>> m_lines;
+    QHash<quintptr, int> m_blocks;
+};
+} // namespace Internal
+} // namespace Minimap
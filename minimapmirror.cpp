@@ -0,0 +1,283 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimapmirror.h"
+
+#include <texteditor/textdocumentlayout.h>
+
+#include <QTextBlock>
+#include <QTextDocument>
+
+namespace Minimap {
+namespace Internal {
+
+void MinimapDocumentMirror::reset(const QTextDocument *doc,
+                                  const MinimapPalette &palette,
+                                  int maxColumns,
+                                  bool highlighted)
+{
+    clear();
+    m_palette = palette;
+    m_maxColumns = maxColumns;
+    m_highlighted = highlighted;
+    m_widthCounts.fill(0, maxColumns + 1);
+    insertLines(0, doc->blockCount());
+    int n(0);
+    for (QTextBlock b = doc->begin(); b.isValid(); b = b.next()) {
+        update(n++, b);
+    }
+    refreshFlags(doc);
+}
+
+void MinimapDocumentMirror::clear()
+{
+    m_snapshot = MinimapSnapshot();
+    m_widthCounts.clear();
+    m_widest = 0;
+    m_colorIndices.clear();
+}
+
+void MinimapDocumentMirror::contentsChange(const QTextDocument *doc,
+                                           int position,
+                                           int charsRemoved,
+                                           int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+    if (lineCount() == 0) {
+        return;
+    }
+    const QTextBlock first = doc->findBlock(position);
+    if (!first.isValid()) {
+        reset(doc, m_palette, m_maxColumns, m_highlighted);
+        return;
+    }
+    const int firstLine = first.blockNumber();
+    const int delta = doc->blockCount() - lineCount();
+    if (delta > 0) {
+        insertLines(firstLine + 1, delta);
+    } else if (delta < 0) {
+        removeLines(firstLine + 1, -delta);
+    }
+    const int lastLine = qMax(firstLine, doc->findBlock(position + charsAdded).blockNumber());
+    QTextBlock b = first;
+    for (int n = firstLine; n <= lastLine && b.isValid(); ++n, b = b.next()) {
+        update(n, b);
+    }
+}
+
+void MinimapDocumentMirror::update(int n, const QTextBlock &block)
+{
+    const bool provisional = m_highlighted && isHighlightPending(block);
+    update(n, block, provisional, blockSignature(block, provisional));
+}
+
+void MinimapDocumentMirror::update(int n,
+                                   const QTextBlock &block,
+                                   bool provisional,
+                                   uint signature)
+{
+    m_arena.reset();
+    const MinimapLine &captured = captureLine(block, m_palette, provisional, m_maxColumns, m_arena);
+
+    MinimapMirrorLine &line = lineAt(n);
+    countWidth(line.text.size(), -1);
+    countWidth(captured.text.size(), 1);
+    line.text = captured.text;
+    line.spans.clear();
+    line.spans.reserve(captured.spans.size());
+    for (const MinimapSpan &s : captured.spans) {
+        line.spans.append(MinimapMirrorSpan{s.start,
+                                            s.length,
+                                            colorIndex(s.background),
+                                            colorIndex(s.foreground)});
+    }
+    line.signature = signature;
+    line.revision = block.revision();
+    line.flags = flagsFor(block) | (provisional ? MinimapMirrorLine::Provisional : 0);
+}
+
+void MinimapDocumentMirror::refreshFlags(const QTextDocument *doc)
+{
+    if (auto layout = qobject_cast<TextEditor::TextDocumentLayout *>(doc->documentLayout())) {
+        m_snapshot.lastSaveRevision = layout->lastSaveRevision;
+    }
+    refreshFlags(doc, 0, lineCount() - 1);
+}
+
+void MinimapDocumentMirror::refreshFlags(const QTextDocument *doc, int first, int last)
+{
+    last = qMin(last, lineCount() - 1);
+    int n = qMax(0, first);
+    for (QTextBlock b = doc->findBlockByNumber(n); b.isValid() && n <= last; b = b.next(), ++n) {
+        const MinimapMirrorLine &line = m_snapshot.line(n);
+        const quint8 flags = flagsFor(b) | (line.flags & MinimapMirrorLine::Provisional);
+        // only touch changed lines, so unchanged snapshots stay shared
+        if (line.flags != flags || line.revision != b.revision()) {
+            MinimapMirrorLine &changed = lineAt(n);
+            changed.flags = flags;
+            changed.revision = b.revision();
+        }
+    }
+}
+
+void MinimapDocumentMirror::resolve(const MinimapSnapshot &snapshot, int n, MinimapLine &line)
+{
+    const MinimapMirrorLine &mirrored = snapshot.line(n);
+    line.text = mirrored.text;
+    line.provisional = mirrored.flags & MinimapMirrorLine::Provisional;
+    line.spans.clear();
+    for (const MinimapMirrorSpan &s : mirrored.spans) {
+        line.spans.append(MinimapSpan{s.start,
+                                      s.length,
+                                      snapshot.colors.at(s.background),
+                                      snapshot.colors.at(s.foreground)});
+    }
+}
+
+MinimapMirrorLine &MinimapDocumentMirror::lineAt(int n)
+{
+    // detaches the chunk of the line only
+    const int c = m_snapshot.chunkOf(n);
+    return m_snapshot.chunks[c][n - m_snapshot.starts.at(c)];
+}
+
+void MinimapDocumentMirror::insertLines(int at, int count)
+{
+    QList<QList<MinimapMirrorLine>> &chunks = m_snapshot.chunks;
+    if (chunks.isEmpty()) {
+        chunks.append(QList<MinimapMirrorLine>());
+        m_snapshot.starts.append(0);
+    }
+    // lines appended at the end go to the last chunk
+    const int c = at < lineCount() ? m_snapshot.chunkOf(at) : static_cast<int>(chunks.size()) - 1;
+    chunks[c].insert(at - m_snapshot.starts.at(c), count, MinimapMirrorLine());
+    m_snapshot.count += count;
+    if (chunks.at(c).size() >= 2 * MinimapSnapshot::chunkSize) {
+        splitChunk(c);
+    }
+    updateStarts(c);
+}
+
+void MinimapDocumentMirror::removeLines(int at, int count)
+{
+    QList<QList<MinimapMirrorLine>> &chunks = m_snapshot.chunks;
+    const int first = m_snapshot.chunkOf(at);
+    int c = first;
+    int offset = at - m_snapshot.starts.at(c);
+    for (int left = count; left > 0 && c < chunks.size();) {
+        const int n = qMin(left, static_cast<int>(chunks.at(c).size()) - offset);
+        for (int i = offset; i < offset + n; ++i) {
+            countWidth(chunks.at(c).at(i).text.size(), -1);
+        }
+        left -= n;
+        if (n == chunks.at(c).size()) {
+            chunks.removeAt(c);
+            m_snapshot.starts.removeAt(c);
+        } else {
+            chunks[c].remove(offset, n);
+            ++c;
+        }
+        offset = 0;
+    }
+    m_snapshot.count -= count;
+    // a small chunk left behind joins its neighbor
+    const int small = qMin(first, static_cast<int>(chunks.size()) - 2);
+    if (small >= 0 && (chunks.at(small).size() < MinimapSnapshot::chunkSize / 4
+                       || chunks.at(small + 1).size() < MinimapSnapshot::chunkSize / 4)) {
+        chunks[small].append(chunks.at(small + 1));
+        chunks.removeAt(small + 1);
+        m_snapshot.starts.removeAt(small + 1);
+        if (chunks.at(small).size() >= 2 * MinimapSnapshot::chunkSize) {
+            splitChunk(small);
+        }
+    }
+    updateStarts(qMax(0, small));
+}
+
+void MinimapDocumentMirror::splitChunk(int c)
+{
+    QList<QList<MinimapMirrorLine>> &chunks = m_snapshot.chunks;
+    const QList<MinimapMirrorLine> lines = std::exchange(chunks[c], QList<MinimapMirrorLine>());
+    chunks.removeAt(c);
+    m_snapshot.starts.removeAt(c);
+    for (qsizetype i = 0; i < lines.size(); i += MinimapSnapshot::chunkSize) {
+        const qsizetype n = qMin(qsizetype(MinimapSnapshot::chunkSize), lines.size() - i);
+        chunks.insert(c, lines.mid(i, n));
+        m_snapshot.starts.insert(c, 0);
+        ++c;
+    }
+}
+
+void MinimapDocumentMirror::updateStarts(int from)
+{
+    QList<int> &starts = m_snapshot.starts;
+    int line = from > 0 ? starts.at(from - 1) + static_cast<int>(m_snapshot.chunks.at(from - 1).size())
+                        : 0;
+    for (int c = from; c < starts.size(); ++c) {
+        starts[c] = line;
+        line += static_cast<int>(m_snapshot.chunks.at(c).size());
+    }
+}
+
+void MinimapDocumentMirror::countWidth(qsizetype width, int delta)
+{
+    // empty lines never make a line the widest one
+    if (width <= 0 || width >= m_widthCounts.size()) {
+        return;
+    }
+    m_widthCounts[width] += delta;
+    if (delta > 0) {
+        m_widest = qMax(m_widest, static_cast<int>(width));
+    } else {
+        while (m_widest > 0 && m_widthCounts.at(m_widest) == 0) {
+            --m_widest;
+        }
+    }
+}
+
+quint16 MinimapDocumentMirror::colorIndex(QRgb color)
+{
+    auto it = m_colorIndices.constFind(color);
+    if (it != m_colorIndices.cend()) {
+        return it.value();
+    }
+    if (m_snapshot.colors.size() > 0xffff) {
+        // out of indices, documents never come close to this
+        return 0;
+    }
+    const quint16 index = static_cast<quint16>(m_snapshot.colors.size());
+    m_snapshot.colors.append(color);
+    m_colorIndices.insert(color, index);
+    return index;
+}
+
+quint8 MinimapDocumentMirror::flagsFor(const QTextBlock &block)
+{
+    quint8 flags(0);
+    if (block.isVisible()) {
+        flags |= MinimapMirrorLine::Visible;
+    }
+    if (TextEditor::TextBlockUserData::isFolded(block)) {
+        flags |= MinimapMirrorLine::Folded;
+    }
+    return flags;
+}
+} // namespace Internal
+} // namespace Minimap
@@ -0,0 +1,159 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include "minimaprasterizer.h"
+
+#include <QHash>
+#include <QList>
+#include <QRgb>
+#include <QString>
+
+#include <algorithm>
+
+class QTextBlock;
+class QTextDocument;
+
+namespace Minimap {
+namespace Internal {
+
+//! A run of characters of a mirrored line. The colors are indices into
+//! MinimapSnapshot::colors.
+struct MinimapMirrorSpan
+{
+    int start;
+    int length;
+    quint16 background;
+    quint16 foreground;
+};
+
+//! A mirrored block, holding at most the first maxColumns() characters.
+struct MinimapMirrorLine
+{
+    enum Flag : quint8 {
+        Visible = 0x01,
+        Folded = 0x02,
+        Provisional = 0x04 //!< the highlighter did not reach the block yet
+    };
+
+    QString text;
+    QList<MinimapMirrorSpan> spans;
+    uint signature = 0; //!< blockSignature() at the time of the capture
+    int revision = 0;
+    quint8 flags = 0;
+};
+
+//! Immutable view of a document mirror. Copies are cheap and share their
+//! data until the mirror changes, so they can be handed to other threads.
+struct MinimapSnapshot
+{
+    //! Lines are kept in chunks of about this size, so changing, inserting
+    //! or removing lines while a copy is held only copies the chunks they
+    //! are in. Chunks are split once they hold twice as many lines and
+    //! merged with their neighbor once they hold less than a quarter.
+    static constexpr int chunkSize = 256;
+
+    int lineCount() const { return count; }
+    const MinimapMirrorLine &line(int n) const
+    {
+        const int c = chunkOf(n);
+        return chunks.at(c).at(n - starts.at(c));
+    }
+
+    //! Returns the chunk holding line @a n.
+    int chunkOf(int n) const
+    {
+        return static_cast<int>(std::upper_bound(starts.cbegin(), starts.cend(), n)
+                                - starts.cbegin())
+               - 1;
+    }
+
+    QList<QList<MinimapMirrorLine>> chunks;
+    QList<int> starts; //!< the first line of every chunk
+    int count = 0;     //!< number of lines held in chunks
+    QList<QRgb> colors;
+    int lastSaveRevision = 0;
+};
+
+//! Compact copy of a document that is maintained incrementally on the GUI
+//! thread from its change notifications and read from anywhere through
+//! snapshots.
+class MinimapDocumentMirror
+{
+public:
+    void reset(const QTextDocument *doc,
+               const MinimapPalette &palette,
+               int maxColumns,
+               bool highlighted);
+    void clear();
+
+    int lineCount() const { return m_snapshot.lineCount(); }
+    int maxColumns() const { return m_maxColumns; }
+    //! Returns the number of characters of the longest mirrored line.
+    int widestLine() const { return m_widest; }
+    bool highlighted() const { return m_highlighted; }
+
+    //! Follows a QTextDocument::contentsChange notification.
+    void contentsChange(const QTextDocument *doc, int position, int charsRemoved, int charsAdded);
+
+    //! Recaptures line @a n from @a block.
+    void update(int n, const QTextBlock &block);
+    //! Recaptures line @a n from @a block, whose blockSignature() for the
+    //! @a provisional state the caller already knows to be @a signature.
+    void update(int n, const QTextBlock &block, bool provisional, uint signature);
+
+    //! Refreshes the visibility, fold and revision state of every line and
+    //! the revision of the last save.
+    void refreshFlags(const QTextDocument *doc);
+    //! Refreshes the visibility, fold and revision state of the lines
+    //! @a first to @a last.
+    void refreshFlags(const QTextDocument *doc, int first, int last);
+
+    uint signature(int n) const { return m_snapshot.line(n).signature; }
+    const MinimapMirrorLine &line(int n) const { return m_snapshot.line(n); }
+
+    //! Resolves line @a n of @a snapshot into @a line for rasterization.
+    static void resolve(const MinimapSnapshot &snapshot, int n, MinimapLine &line);
+
+    MinimapSnapshot snapshot() const { return m_snapshot; }
+    const MinimapSnapshot &current() const { return m_snapshot; }
+
+private:
+    MinimapMirrorLine &lineAt(int n);
+    void insertLines(int at, int count);
+    void removeLines(int at, int count);
+    void splitChunk(int c);
+    void updateStarts(int from);
+    void countWidth(qsizetype width, int delta);
+    quint16 colorIndex(QRgb color);
+    static quint8 flagsFor(const QTextBlock &block);
+
+    MinimapSnapshot m_snapshot;
+    QList<int> m_widthCounts; //!< lines per number of characters
+    int m_widest = 0;
+    QHash<QRgb, quint16> m_colorIndices;
+    MinimapPalette m_palette;
+    MinimapArena m_arena;
+    int m_maxColumns = 0;
+    bool m_highlighted = false;
+};
+} // namespace Internal
+} // namespace Minimap
@@ -0,0 +1,185 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimapprerenderer.h"
+#include "minimapsettings.h"
+
+#include <utils/qtcassert.h>
+
+#include <QApplication>
+#include <QEvent>
+
+namespace Minimap {
+namespace Internal {
+namespace {
+// time without input after which preparing is resumed
+const int idleDelay = 300; // ms
+// longest slice of work between two returns to the event loop
+const int sliceDuration = 4; // ms
+
+MinimapPrerenderer *m_instance = 0;
+
+bool isInput(QEvent::Type type)
+{
+    switch (type) {
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+    case QEvent::ShortcutOverride:
+    case QEvent::InputMethod:
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::MouseMove:
+    case QEvent::Wheel:
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+        return true;
+    default:
+        return false;
+    }
+}
+} // namespace
+
+MinimapPrerenderer::MinimapPrerenderer(QObject *parent)
+    : QObject(parent)
+    , m_filtering(false)
+{
+    QTC_ASSERT(!m_instance, return);
+    m_instance = this;
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &MinimapPrerenderer::step);
+    connect(MinimapSettings::instance(),
+            &MinimapSettings::prerenderMemoryChanged,
+            this,
+            &MinimapPrerenderer::memoryCapChanged);
+}
+
+MinimapPrerenderer::~MinimapPrerenderer()
+{
+    if (m_filtering) {
+        qApp->removeEventFilter(this);
+    }
+    m_instance = 0;
+}
+
+MinimapPrerenderer *MinimapPrerenderer::instance()
+{
+    return m_instance;
+}
+
+void MinimapPrerenderer::add(MinimapPrerenderable *target)
+{
+    if (MinimapSettings::prerenderMemory() <= 0) {
+        return;
+    }
+    remove(target);
+    m_pending.append(target);
+    if (!m_filtering) {
+        m_filtering = true;
+        qApp->installEventFilter(this);
+    }
+    // editors are mostly opened in bursts, let them settle first
+    schedule(idleDelay);
+}
+
+void MinimapPrerenderer::remove(MinimapPrerenderable *target)
+{
+    m_pending.removeOne(target);
+    m_prepared.removeIf([target](const Prepared &p) { return p.target == target; });
+}
+
+bool MinimapPrerenderer::eventFilter(QObject *watched, QEvent *event)
+{
+    Q_UNUSED(watched);
+    if (isInput(event->type())) {
+        schedule(idleDelay);
+    }
+    return false;
+}
+
+void MinimapPrerenderer::schedule(int delay)
+{
+    if (m_pending.isEmpty()) {
+        m_timer.stop();
+        if (m_filtering) {
+            m_filtering = false;
+            qApp->removeEventFilter(this);
+        }
+        return;
+    }
+    // input postpones a pending slice, it never brings one forward
+    if (!m_timer.isActive() || delay > 0) {
+        m_timer.start(delay);
+    }
+}
+
+void MinimapPrerenderer::step()
+{
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    if (QApplication::mouseButtons() != Qt::NoButton) {
+        // a drag is not over until the buttons are released
+        schedule(idleDelay);
+        return;
+    }
+    MinimapPrerenderable *target = m_pending.last();
+    const bool done = target->prerender(QDeadlineTimer(sliceDuration));
+    const qint64 bytes = target->prerenderedBytes();
+    if (done) {
+        m_pending.removeLast();
+        m_prepared.append(Prepared{target, bytes});
+        enforceCap(0);
+    } else if (enforceCap(bytes) > qint64(MinimapSettings::prerenderMemory()) * 1024 * 1024) {
+        // does not fit on its own, it is rendered when shown instead
+        target->dropPrerendered();
+        m_pending.removeLast();
+    }
+    schedule(0);
+}
+
+void MinimapPrerenderer::memoryCapChanged()
+{
+    enforceCap(0);
+    if (MinimapSettings::prerenderMemory() <= 0) {
+        m_pending.clear();
+        schedule(0);
+    }
+}
+
+//! Releases the least recently prepared minimaps until they fit into the
+//! memory cap along with the @a inProgress bytes of the one being prepared.
+//! Returns the memory held afterwards.
+qint64 MinimapPrerenderer::enforceCap(qint64 inProgress)
+{
+    const qint64 cap = qint64(MinimapSettings::prerenderMemory()) * 1024 * 1024;
+    qint64 total = inProgress;
+    for (const Prepared &p : std::as_const(m_prepared)) {
+        total += p.bytes;
+    }
+    while (total > cap && !m_prepared.isEmpty()) {
+        const Prepared oldest = m_prepared.takeFirst();
+        oldest.target->dropPrerendered();
+        total -= oldest.bytes;
+    }
+    return total;
+}
+} // namespace Internal
+} // namespace Minimap
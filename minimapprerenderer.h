@@ -0,0 +1,88 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include <QDeadlineTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+namespace Minimap {
+namespace Internal {
+
+//! A minimap that can be prepared while its editor is not shown.
+class MinimapPrerenderable
+{
+public:
+    virtual ~MinimapPrerenderable() = default;
+
+    //! Does part of the preparation, returning at the latest once
+    //! @a deadline expired. Returns true when nothing is left to do.
+    virtual bool prerender(const QDeadlineTimer &deadline) = 0;
+    //! Returns the memory held by what was prepared so far, in bytes.
+    virtual qint64 prerenderedBytes() const = 0;
+    //! Releases what was prepared.
+    virtual void dropPrerendered() = 0;
+};
+
+//! Prepares the minimaps of editors opened in the background while the
+//! application is idle, so switching to them shows a finished minimap.
+//!
+//! The work is split into short slices run from a timer, the most recently
+//! opened editor first, and pauses for a while on every input event. The
+//! memory held by prepared minimaps that were not shown yet is capped, the
+//! least recently prepared ones are released first.
+class MinimapPrerenderer : public QObject
+{
+public:
+    explicit MinimapPrerenderer(QObject *parent);
+    ~MinimapPrerenderer();
+
+    static MinimapPrerenderer *instance();
+
+    //! Queues @a target in front of the ones queued before.
+    void add(MinimapPrerenderable *target);
+    //! Forgets @a target, once it is shown or destroyed. What it prepared
+    //! is left to it.
+    void remove(MinimapPrerenderable *target);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Prepared
+    {
+        MinimapPrerenderable *target;
+        qint64 bytes;
+    };
+
+    void schedule(int delay);
+    void step();
+    void memoryCapChanged();
+    qint64 enforceCap(qint64 inProgress);
+
+    QList<MinimapPrerenderable *> m_pending; //!< most recently added last
+    QList<Prepared> m_prepared;              //!< least recently prepared first
+    QTimer m_timer;
+    bool m_filtering;
+};
+} // namespace Internal
+} // namespace Minimap
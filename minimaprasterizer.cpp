@@ -0,0 +1,776 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimaprasterizer.h"
+
+#include <QHashFunctions>
+#include <QTextBlock>
+#include <QTextLayout>
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MINIMAP_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MINIMAP_NEON
+#endif
+
+namespace Minimap {
+namespace Internal {
+namespace {
+inline QRgb ink(QRgb c)
+{
+    return c | 0xff000000;
+}
+
+inline QRgb blank(QRgb c)
+{
+    return c & 0x00ffffff;
+}
+
+inline bool updatePixel(QRgb *row, const QChar &c, int &x, int w, int tab, QRgb bg, QRgb fg)
+{
+    if (c == QChar::Tabulation) {
+        for (int i = 0; i < tab && x < w; ++i) {
+            row[x++] = bg;
+        }
+    } else {
+        row[x++] = c.isSpace() ? bg : fg;
+    }
+    return x < w;
+}
+
+inline void merge(QColor &bg, QColor &fg, const QTextCharFormat &f)
+{
+    if (f.background().style() != Qt::NoBrush) {
+        bg = f.background().color();
+    }
+    if (f.foreground().style() != Qt::NoBrush) {
+        fg = f.foreground().color();
+    }
+}
+
+inline QRgb brushKey(const QBrush &brush)
+{
+    return brush.style() != Qt::NoBrush ? brush.color().rgba() : 0;
+}
+
+inline void fillRemaining(QRgb *row, int x, int w, const MinimapPalette &palette)
+{
+    std::fill(row + qMin(x, w), row + w, blank(palette.background.rgb()));
+}
+
+inline void appendSpan(QList<MinimapSpan> &spans, int start, int length, QRgb bg, QRgb fg)
+{
+    if (length <= 0) {
+        return;
+    }
+    if (!spans.isEmpty()) {
+        MinimapSpan &last = spans.last();
+        if (last.start + last.length == start && last.background == bg && last.foreground == fg) {
+            last.length += length;
+            return;
+        }
+    }
+    spans.append(MinimapSpan{start, length, bg, fg});
+}
+
+// rows and columns of the outline of a magnified character: an ascender
+// row, two rows of x-height and a descender row
+const int glyphRows = 4;
+const int glyphColumns = 2;
+
+//! Returns the outline bits of @a first to @a last rows in @a columns.
+constexpr quint8 glyphBits(int first, int last, quint8 columns = 0x3)
+{
+    quint8 bits(0);
+    for (int row = first; row <= last; ++row) {
+        bits |= static_cast<quint8>(columns << (row * glyphColumns));
+    }
+    return bits;
+}
+
+//! Returns the outline of @a c, one bit per row and column.
+quint8 glyphOutline(QChar c)
+{
+    const char16_t u = c.unicode();
+    if (c.isSpace()) {
+        return 0;
+    }
+    if (u >= 0x80) {
+        if (c.isUpper()) {
+            return glyphBits(0, 2);
+        }
+        if (c.isLower()) {
+            return glyphBits(1, 2);
+        }
+        // ideographs and the like fill their whole cell
+        return c.isLetterOrNumber() ? glyphBits(0, 3) : glyphBits(1, 2, 0x1);
+    }
+    if ((u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9')) {
+        return glyphBits(0, 2);
+    }
+    switch (u) {
+    case 'b':
+    case 'd':
+    case 'f':
+    case 'h':
+    case 'i':
+    case 'k':
+    case 'l':
+    case 't':
+    case '#':
+    case '$':
+    case '%':
+    case '&':
+    case '@':
+    case '?':
+        return glyphBits(0, 2);
+    case 'g':
+    case 'j':
+    case 'p':
+    case 'q':
+    case 'y':
+        return glyphBits(1, 3);
+    case '.':
+        return glyphBits(2, 2, 0x1);
+    case ',':
+        return glyphBits(2, 3, 0x1);
+    case ':':
+        return glyphBits(1, 2, 0x1);
+    case ';':
+        return glyphBits(1, 3, 0x1);
+    case '!':
+        return glyphBits(0, 2, 0x1);
+    case '|':
+        return glyphBits(0, 3, 0x1);
+    case '\'':
+    case '`':
+        return glyphBits(0, 0, 0x1);
+    case '"':
+    case '^':
+        return glyphBits(0, 0);
+    case '_':
+        return glyphBits(3, 3);
+    case '-':
+    case '~':
+        return glyphBits(1, 1);
+    case '(':
+    case '[':
+    case '{':
+        // hugging what they enclose
+        return glyphBits(0, 3, 0x2);
+    case ')':
+    case ']':
+    case '}':
+        return glyphBits(0, 3, 0x1);
+    case '/':
+        return glyphBits(0, 1, 0x2) | glyphBits(2, 3, 0x1);
+    case '\\':
+        return glyphBits(0, 1, 0x1) | glyphBits(2, 3, 0x2);
+    case '<':
+        return glyphBits(1, 1, 0x2) | glyphBits(2, 2, 0x1);
+    case '>':
+        return glyphBits(1, 1, 0x1) | glyphBits(2, 2, 0x2);
+    default:
+        // the remaining lowercase letters and operators
+        return glyphBits(1, 2);
+    }
+}
+
+// Longest line handled by the ASCII fast path, longer lines take the
+// scalar path.
+const int maxAsciiLength = 2048;
+
+//! Character classes of an ASCII line, one bit per UTF-16 unit.
+struct AsciiClasses
+{
+    quint32 blank[maxAsciiLength / 32]; // whitespace except tabulations
+    quint32 tab[maxAsciiLength / 32];
+};
+
+inline bool isBlankAscii(ushort u)
+{
+    return u == ' ' || (u >= 0x0a && u <= 0x0d);
+}
+
+//! Classifies 16 units starting at @a u. Returns false if any of them is not ASCII.
+inline bool classify16(const ushort *u, quint32 &blank, quint32 &tab)
+{
+#if defined(MINIMAP_SSE2)
+    const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u));
+    const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + 8));
+    const __m128i nonAsciiBits = _mm_set1_epi16(static_cast<short>(0xff80));
+    const __m128i nonAscii = _mm_or_si128(_mm_and_si128(lo, nonAsciiBits),
+                                          _mm_and_si128(hi, nonAsciiBits));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, _mm_setzero_si128())) != 0xffff) {
+        return false;
+    }
+    auto isBlank = [](__m128i v) {
+        const __m128i control = _mm_sub_epi16(v, _mm_set1_epi16(0x0a));
+        return _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16(' ')),
+                            _mm_and_si128(_mm_cmpgt_epi16(control, _mm_set1_epi16(-1)),
+                                          _mm_cmplt_epi16(control, _mm_set1_epi16(4))));
+    };
+    const __m128i tabs = _mm_set1_epi16('\t');
+    blank = static_cast<quint32>(_mm_movemask_epi8(_mm_packs_epi16(isBlank(lo), isBlank(hi))));
+    tab = static_cast<quint32>(_mm_movemask_epi8(
+        _mm_packs_epi16(_mm_cmpeq_epi16(lo, tabs), _mm_cmpeq_epi16(hi, tabs))));
+    return true;
+#elif defined(MINIMAP_NEON)
+    static const uint16_t weights[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+    const uint16x8_t w = vld1q_u16(weights);
+    auto mask = [w](uint16x8_t lo, uint16x8_t hi) {
+        return static_cast<quint32>(vaddvq_u16(vandq_u16(lo, w)))
+               | (static_cast<quint32>(vaddvq_u16(vandq_u16(hi, w))) << 8);
+    };
+    const uint16x8_t lo = vld1q_u16(u);
+    const uint16x8_t hi = vld1q_u16(u + 8);
+    if (vmaxvq_u16(vorrq_u16(lo, hi)) >= 0x80) {
+        return false;
+    }
+    auto isBlank = [](uint16x8_t v) {
+        return vorrq_u16(vceqq_u16(v, vdupq_n_u16(' ')),
+                         vcleq_u16(vsubq_u16(v, vdupq_n_u16(0x0a)), vdupq_n_u16(3)));
+    };
+    blank = mask(isBlank(lo), isBlank(hi));
+    tab = mask(vceqq_u16(lo, vdupq_n_u16('\t')), vceqq_u16(hi, vdupq_n_u16('\t')));
+    return true;
+#else
+    blank = 0;
+    tab = 0;
+    ushort any = 0;
+    for (int i = 0; i < 16; ++i) {
+        any |= u[i];
+        blank |= quint32(isBlankAscii(u[i])) << i;
+        tab |= quint32(u[i] == '\t') << i;
+    }
+    return any < 0x80;
+#endif
+}
+
+//! Classifies @a text into @a classes. Returns false if the text is too long
+//! or contains non-ASCII characters.
+bool classifyAscii(const QString &text, AsciiClasses &classes)
+{
+    const int length = text.size();
+    if (length > maxAsciiLength) {
+        return false;
+    }
+    const ushort *u = reinterpret_cast<const ushort *>(text.constData());
+    int i = 0;
+    for (; i + 16 <= length; i += 16) {
+        quint32 blank, tab;
+        if (!classify16(u + i, blank, tab)) {
+            return false;
+        }
+        quint32 &blankWord = classes.blank[i / 32];
+        quint32 &tabWord = classes.tab[i / 32];
+        if (i % 32 == 0) {
+            blankWord = blank;
+            tabWord = tab;
+        } else {
+            blankWord |= blank << 16;
+            tabWord |= tab << 16;
+        }
+    }
+    for (; i < length; ++i) {
+        if (u[i] >= 0x80) {
+            return false;
+        }
+        const quint32 bit = 1u << (i % 32);
+        quint32 &blankWord = classes.blank[i / 32];
+        quint32 &tabWord = classes.tab[i / 32];
+        if (i % 32 == 0) {
+            blankWord = 0;
+            tabWord = 0;
+        }
+        if (isBlankAscii(u[i])) {
+            blankWord |= bit;
+        } else if (u[i] == '\t') {
+            tabWord |= bit;
+        }
+    }
+    return true;
+}
+
+//! Returns the end of the run of blank or ink characters starting at @a from.
+//! Tabulations always end a run.
+inline int runEnd(const AsciiClasses &classes, int from, int end, bool blank)
+{
+    for (int i = from; i < end;) {
+        const int word = i / 32;
+        quint32 stop = (blank ? ~classes.blank[word] : classes.blank[word]) | classes.tab[word];
+        stop &= ~0u << (i % 32);
+        if (stop) {
+            return qMin(end, word * 32 + std::countr_zero(stop));
+        }
+        i = (word + 1) * 32;
+    }
+    return end;
+}
+
+//! Rasterizes an ASCII line run by run instead of character by character.
+int rasterizeAscii(const MinimapLine &line,
+                   const AsciiClasses &classes,
+                   QRgb *row,
+                   int w,
+                   int tab)
+{
+    int x(0);
+    for (const MinimapSpan &span : line.spans) {
+        const QRgb bg = blank(span.background);
+        const QRgb fg = ink(span.foreground);
+        const int end = span.start + span.length;
+        for (int i = span.start; i < end && x < w;) {
+            if (classes.tab[i / 32] & (1u << (i % 32))) {
+                const int n = qMin(tab, w - x);
+                std::fill(row + x, row + x + n, bg);
+                x += n;
+                ++i;
+                continue;
+            }
+            const bool isBlank = classes.blank[i / 32] & (1u << (i % 32));
+            const int next = runEnd(classes, i + 1, end, isBlank);
+            const int n = qMin(next - i, w - x);
+            std::fill(row + x, row + x + n, isBlank ? bg : fg);
+            x += n;
+            i = next;
+        }
+        if (x >= w) {
+            break;
+        }
+    }
+    return x;
+}
+
+int rasterizeProvisional(const QString &text,
+                         QRgb *row,
+                         int w,
+                         int tab,
+                         const MinimapPalette &palette)
+{
+    const QRgb bg = blank(palette.background.rgb());
+    const QRgb fg = ink(palette.foreground.rgb());
+    const QRgb punctuation = ink(palette.punctuation.rgb());
+    const QRgb comment = ink(palette.comment.rgb());
+
+    int x(0);
+    bool cont(x < w);
+    bool inComment(false);
+    bool leading(true);
+    for (int i = 0; i < text.length() && cont; ++i) {
+        const QChar c = text.at(i);
+        if (!inComment) {
+            const QChar next = i + 1 < text.length() ? text.at(i + 1) : QChar();
+            if (c == QLatin1Char('/') && (next == QLatin1Char('/') || next == QLatin1Char('*'))) {
+                inComment = true;
+            } else if (leading && c == QLatin1Char('*')
+                       && (next.isNull() || next.isSpace() || next == QLatin1Char('/'))) {
+                // most likely the continuation of a block comment
+                inComment = true;
+            }
+        }
+        if (!c.isSpace()) {
+            leading = false;
+        }
+        QRgb color = fg;
+        if (inComment) {
+            color = comment;
+        } else if (!c.isLetterOrNumber() && c != QLatin1Char('_')) {
+            color = punctuation;
+        }
+        cont = updatePixel(row, c, x, w, tab, bg, color);
+        if (inComment && c == QLatin1Char('/') && i > 0 && text.at(i - 1) == QLatin1Char('*')) {
+            inComment = false;
+        }
+    }
+    fillRemaining(row, x, w, palette);
+    return qMin(x, w);
+}
+
+int rasterizeReduced(const QString &text,
+                     EMinimapDetail detail,
+                     QRgb *row,
+                     int w,
+                     int tab,
+                     const MinimapPalette &palette)
+{
+    const QRgb bg = blank(palette.background.rgb());
+    const QRgb fg = ink(palette.foreground.rgb());
+
+    int x(0);
+    if (detail == EMinimapDetail::eRuns) {
+        bool cont(x < w);
+        for (int i = 0; i < text.length() && cont; ++i) {
+            cont = updatePixel(row, text.at(i), x, w, tab, bg, fg);
+        }
+        fillRemaining(row, x, w, palette);
+        return qMin(x, w);
+    }
+
+    // a single bar from the indentation to the last character
+    int indent(0);
+    int i(0);
+    for (; i < text.length() && text.at(i).isSpace(); ++i) {
+        indent += text.at(i) == QChar::Tabulation ? tab : 1;
+    }
+    int last = text.length();
+    while (last > i && text.at(last - 1).isSpace()) {
+        --last;
+    }
+    x = qMin(indent, w);
+    std::fill(row, row + x, bg);
+    const int end = qMin(indent + last - i, w);
+    std::fill(row + x, row + end, fg);
+    x = end;
+    fillRemaining(row, x, w, palette);
+    return x;
+}
+
+//! Draws the indentation of @a line and a bar in the foreground color of
+//! each of its spans, costing a fill per span instead of work per character.
+int rasterizeStructure(const MinimapLine &line,
+                       QRgb *row,
+                       int w,
+                       int tab,
+                       const MinimapPalette &palette)
+{
+    const QRgb bg = blank(palette.background.rgb());
+    const QString &text = line.text;
+    // spans are ordered, so columns are only ever advanced
+    int c(0);
+    int column(0);
+    auto columnOf = [&](int i) {
+        for (; c < i; ++c) {
+            column += text.at(c) == QChar::Tabulation ? tab : 1;
+        }
+        return column;
+    };
+
+    int x(0);
+    for (const MinimapSpan &span : line.spans) {
+        int start = span.start;
+        int end = span.start + span.length;
+        while (start < end && text.at(start).isSpace()) {
+            ++start;
+        }
+        while (end > start && text.at(end - 1).isSpace()) {
+            --end;
+        }
+        if (start == end || start < c) {
+            continue;
+        }
+        const int begin = qMin(columnOf(start), w);
+        std::fill(row + x, row + begin, bg);
+        x = qMin(columnOf(end), w);
+        std::fill(row + begin, row + x, ink(span.foreground));
+        if (x >= w) {
+            break;
+        }
+    }
+    fillRemaining(row, x, w, palette);
+    return x;
+}
+
+//! Reduces @a k pixels starting at @a src to one, weighting the average
+//! color of their ink with its coverage against @a bg. Sums are kept in 16
+//! bit fixed point lanes, which holds for any k up to 256.
+inline QRgb reducePixels(const QRgb *src, int k, QRgb bg)
+{
+    quint32 b(0), g(0), r(0), count(0);
+    int i(0);
+#if defined(MINIMAP_SSE2)
+    __m128i sum = _mm_setzero_si128();
+    for (; i + 2 <= k; i += 2) {
+        const __m128i px = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+        // ink has an opaque alpha, blank pixels a transparent one
+        const __m128i inked = _mm_and_si128(px, _mm_srai_epi32(px, 24));
+        sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(inked, _mm_setzero_si128()));
+    }
+    sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+    b = static_cast<quint32>(_mm_extract_epi16(sum, 0));
+    g = static_cast<quint32>(_mm_extract_epi16(sum, 1));
+    r = static_cast<quint32>(_mm_extract_epi16(sum, 2));
+    count = static_cast<quint32>(_mm_extract_epi16(sum, 3)) / 255;
+#elif defined(MINIMAP_NEON)
+    uint16x8_t sum = vdupq_n_u16(0);
+    for (; i + 2 <= k; i += 2) {
+        const uint32x2_t px = vld1_u32(src + i);
+        const uint32x2_t inked = vand_u32(px, vreinterpret_u32_s32(
+                                                  vshr_n_s32(vreinterpret_s32_u32(px), 24)));
+        sum = vaddq_u16(sum, vmovl_u8(vreinterpret_u8_u32(inked)));
+    }
+    const uint16x4_t total = vadd_u16(vget_low_u16(sum), vget_high_u16(sum));
+    b = vget_lane_u16(total, 0);
+    g = vget_lane_u16(total, 1);
+    r = vget_lane_u16(total, 2);
+    count = vget_lane_u16(total, 3) / 255u;
+#endif
+    for (; i < k; ++i) {
+        if (qAlpha(src[i]) != 0) {
+            b += qBlue(src[i]);
+            g += qGreen(src[i]);
+            r += qRed(src[i]);
+            ++count;
+        }
+    }
+    if (count == 0) {
+        return bg;
+    }
+    const quint32 rest = static_cast<quint32>(k) - count;
+    return qRgb((qRed(bg) * rest + r) / k, (qGreen(bg) * rest + g) / k, (qBlue(bg) * rest + b) / k);
+}
+
+//! Compresses a row of @a w * @a k pixels at @a src into @a w pixels.
+inline void compressRow(const QRgb *src, QRgb *row, int w, int k, QRgb bg)
+{
+    for (int x = 0; x < w; ++x) {
+        row[x] = reducePixels(src + x * k, k, bg);
+    }
+}
+
+int rasterizeUncompressed(const MinimapLine &line,
+                          QRgb *row,
+                          int w,
+                          int tab,
+                          const MinimapPalette &palette)
+{
+    if (line.detail != EMinimapDetail::eFull) {
+        return rasterizeReduced(line.text, line.detail, row, w, tab, palette);
+    }
+    if (line.provisional) {
+        return rasterizeProvisional(line.text, row, w, tab, palette);
+    }
+    if (line.structural) {
+        return rasterizeStructure(line, row, w, tab, palette);
+    }
+
+    AsciiClasses classes;
+    if (classifyAscii(line.text, classes)) {
+        const int x = rasterizeAscii(line, classes, row, w, tab);
+        fillRemaining(row, x, w, palette);
+        return qMin(x, w);
+    }
+
+    int x(0);
+    bool cont(x < w);
+    for (const MinimapSpan &span : line.spans) {
+        const QRgb bg = blank(span.background);
+        const QRgb fg = ink(span.foreground);
+        const int end = span.start + span.length;
+        for (int i = span.start; i < end && cont; ++i) {
+            cont = updatePixel(row, line.text.at(i), x, w, tab, bg, fg);
+        }
+        if (!cont) {
+            break;
+        }
+    }
+    fillRemaining(row, x, w, palette);
+    return qMin(x, w);
+}
+} // namespace
+
+MinimapLine &MinimapArena::nextLine()
+{
+    if (m_used == m_lines.size()) {
+        m_lines.append(MinimapLine());
+    }
+    MinimapLine &line = m_lines[m_used++];
+    line.spans.clear();
+    line.provisional = false;
+    line.detail = EMinimapDetail::eFull;
+    line.structural = false;
+    line.compression = 1;
+    return line;
+}
+
+bool isHighlightPending(const QTextBlock &block)
+{
+    return block.userState() == -1 && block.layout()->formats().isEmpty();
+}
+
+uint blockSignature(const QTextBlock &block, bool provisional)
+{
+    size_t seed = qHashMulti(0, block.revision(), block.length(), provisional);
+    if (!provisional) {
+        const QList<QTextLayout::FormatRange> formats = block.layout()->formats();
+        for (const QTextLayout::FormatRange &r : formats) {
+            seed = qHashMulti(seed,
+                              r.start,
+                              r.length,
+                              brushKey(r.format.foreground()),
+                              brushKey(r.format.background()));
+        }
+    }
+    return static_cast<uint>(seed);
+}
+
+MinimapLine &captureLine(const QTextBlock &block,
+                         const MinimapPalette &palette,
+                         bool provisional,
+                         int maxLength,
+                         MinimapArena &arena)
+{
+    MinimapLine &line = arena.nextLine();
+    line.provisional = provisional;
+    line.text = block.text();
+    if (line.text.size() > maxLength) {
+        line.text.truncate(qMax(0, maxLength));
+    }
+    if (provisional) {
+        return line;
+    }
+
+    // highlighters usually hand out sorted ranges, only copy them if not
+    const auto lessThan = [](const QTextLayout::FormatRange &r1,
+                             const QTextLayout::FormatRange &r2) {
+        if (r1.start < r2.start) {
+            return true;
+        } else if (r1.start > r2.start) {
+            return false;
+        }
+        return r1.length < r2.length;
+    };
+    const QList<QTextLayout::FormatRange> layoutFormats = block.layout()->formats();
+    const QList<QTextLayout::FormatRange> *sortedFormats = &layoutFormats;
+    if (!std::is_sorted(layoutFormats.cbegin(), layoutFormats.cend(), lessThan)) {
+        QList<QTextLayout::FormatRange> &scratch = arena.formats();
+        scratch.clear();
+        scratch.append(layoutFormats);
+        std::sort(scratch.begin(), scratch.end(), lessThan);
+        sortedFormats = &scratch;
+    }
+    const QList<QTextLayout::FormatRange> &formats = *sortedFormats;
+
+    QColor bBg = palette.background;
+    QColor bFg = palette.foreground;
+    merge(bBg, bFg, block.charFormat());
+
+    const int length = line.text.size();
+    auto itFormat = formats.cbegin();
+    for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+        QTextFragment f = it.fragment();
+        if (!f.isValid()) {
+            continue;
+        }
+        const int offset = f.position() - block.position();
+        if (offset >= length) {
+            break;
+        }
+        QColor fBg = bBg;
+        QColor fFg = bFg;
+        merge(fBg, fFg, f.charFormat());
+
+        const int end = qMin(offset + f.length(), length);
+        for (int pos = offset; pos < end;) {
+            while (itFormat != formats.cend() && itFormat->start + itFormat->length <= pos) {
+                ++itFormat;
+            }
+            QColor bg = fBg;
+            QColor fg = fFg;
+            int next = end;
+            if (itFormat != formats.cend()) {
+                if (pos >= itFormat->start) {
+                    merge(bg, fg, itFormat->format);
+                    next = qMin(next, itFormat->start + itFormat->length);
+                } else {
+                    next = qMin(next, itFormat->start);
+                }
+            }
+            appendSpan(line.spans, pos, next - pos, bg.rgb(), fg.rgb());
+            pos = next;
+        }
+    }
+    return line;
+}
+
+int rasterizeLine(const MinimapLine &line,
+                  QRgb *row,
+                  int w,
+                  int tab,
+                  const MinimapPalette &palette)
+{
+    const int k = line.compression;
+    if (k <= 1) {
+        return rasterizeUncompressed(line, row, w, tab, palette);
+    }
+    // every character is rasterized once at full width, then each group of
+    // k pixels is reduced to one
+    thread_local std::vector<QRgb> wide;
+    wide.resize(static_cast<size_t>(w) * k);
+    const int extent = rasterizeUncompressed(line, wide.data(), w * k, tab, palette);
+    compressRow(wide.data(), row, w, k, blank(palette.background.rgb()));
+    return (extent + k - 1) / k;
+}
+
+int rasterizeGlyphs(const MinimapLine &line,
+                    QRgb *pixels,
+                    qsizetype stride,
+                    int w,
+                    int zoom,
+                    int height,
+                    int tab,
+                    const MinimapPalette &palette)
+{
+    // the colors are those of the row, one pixel per column
+    thread_local std::vector<QRgb> colors;
+    colors.resize(static_cast<size_t>(qMax(0, w)));
+    const int extent = rasterizeUncompressed(line, colors.data(), w, tab, palette);
+
+    const QRgb background = ink(palette.background.rgb());
+    qsizetype span(0);
+    int x(0);
+    for (int i = 0; i < line.text.size() && x < w; ++i) {
+        const QChar c = line.text.at(i);
+        while (span < line.spans.size()
+               && line.spans.at(span).start + line.spans.at(span).length <= i) {
+            ++span;
+        }
+        const QRgb bg = span < line.spans.size() && line.spans.at(span).start <= i
+                            ? ink(line.spans.at(span).background)
+                            : background;
+        const quint8 outline = glyphOutline(c);
+        const int cells = c == QChar::Tabulation ? qMin(tab, w - x) : 1;
+        for (int cell = 0; cell < cells; ++cell, ++x) {
+            const QRgb fg = ink(colors[x]);
+            for (int dy = 0; dy < height; ++dy) {
+                QRgb *p = pixels + dy * stride + qsizetype(x) * zoom;
+                const int glyphRow = dy * glyphRows / height;
+                for (int dx = 0; dx < zoom; ++dx) {
+                    const int bit = glyphRow * glyphColumns + dx * glyphColumns / zoom;
+                    p[dx] = outline & (1u << bit) ? fg : bg;
+                }
+            }
+        }
+    }
+    // the rest of the line
+    for (int dy = 0; dy < height; ++dy) {
+        QRgb *p = pixels + dy * stride;
+        std::fill(p + qsizetype(x) * zoom, p + qsizetype(w) * zoom, background);
+    }
+    return extent;
+}
+} // namespace Internal
+} // namespace Minimap
@@ -0,0 +1,132 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include "minimapconstants.h"
+
+#include <QColor>
+#include <QList>
+#include <QRgb>
+#include <QString>
+#include <QTextLayout>
+
+class QTextBlock;
+
+namespace Minimap {
+namespace Internal {
+
+//! Colors used when rasterizing blocks into minimap rows.
+struct MinimapPalette
+{
+    QColor background;
+    QColor foreground;
+    QColor punctuation;
+    QColor comment;
+};
+
+//! A run of characters sharing the same resolved colors.
+struct MinimapSpan
+{
+    int start;
+    int length;
+    QRgb background;
+    QRgb foreground;
+};
+
+//! Snapshot of everything needed to rasterize a block. Lines are captured
+//! on the GUI thread and can be rasterized on any thread.
+struct MinimapLine
+{
+    QString text;
+    QList<MinimapSpan> spans;
+    bool provisional = false;
+    EMinimapDetail detail = EMinimapDetail::eFull;
+    bool structural = false; //!< draw the indentation and one bar per token
+    int compression = 1;     //!< characters averaged into one pixel
+};
+
+//! Scratch buffers reused from frame to frame. Once they have grown to their
+//! working size, capturing lines does not allocate except for the text of
+//! the captured blocks.
+class MinimapArena
+{
+public:
+    void reset() { m_used = 0; }
+
+    //! Returns a cleared line that stays valid until the next reset().
+    MinimapLine &nextLine();
+
+    MinimapLine &line(int i) { return m_lines[i]; }
+    const MinimapLine *lines() const { return m_lines.constData(); }
+    int lineCount() const { return m_used; }
+
+    QList<QTextLayout::FormatRange> &formats() { return m_formats; }
+
+private:
+    QList<MinimapLine> m_lines;
+    QList<QTextLayout::FormatRange> m_formats;
+    int m_used = 0;
+};
+
+//! Returns true if the syntax highlighter has not yet reached @a block.
+bool isHighlightPending(const QTextBlock &block);
+
+//! Returns a value that changes whenever the rendering of @a block would change.
+uint blockSignature(const QTextBlock &block, bool provisional);
+
+//! Captures the first @a maxLength characters of @a block and their colors
+//! into a line of @a arena. Provisional lines only capture the text; they are
+//! rasterized using a cheap character class coloring until the highlighter
+//! reaches the block.
+MinimapLine &captureLine(const QTextBlock &block,
+                         const MinimapPalette &palette,
+                         bool provisional,
+                         int maxLength,
+                         MinimapArena &arena);
+
+//! Rasterizes @a line into @a row. Returns the number of pixels covered by
+//! the text of the line. Lines captured at a reduced detail only need their
+//! text and are drawn in the text color. Structural lines draw each format
+//! span as a bar from its first to its last non-blank character. Compressed
+//! lines are rasterized at their full width and downsampled, each pixel
+//! showing the ink coverage of the characters it stands for.
+int rasterizeLine(const MinimapLine &line,
+                  QRgb *row,
+                  int w,
+                  int tab,
+                  const MinimapPalette &palette);
+
+//! Rasterizes @a line magnified, each of its first @a w columns into a cell
+//! of @a zoom by @a height opaque pixels at @a pixels, whose scanlines are
+//! @a stride pixels apart. Instead of a solid block every character gets a
+//! rough outline of its shape, telling capitals, ascenders, descenders and
+//! punctuation apart without laying out any text. The line is drawn at full
+//! detail and uncompressed. Returns the number of columns covered by text.
+int rasterizeGlyphs(const MinimapLine &line,
+                    QRgb *pixels,
+                    qsizetype stride,
+                    int w,
+                    int zoom,
+                    int height,
+                    int tab,
+                    const MinimapPalette &palette);
+} // namespace Internal
+} // namespace Minimap
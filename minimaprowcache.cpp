@@ -0,0 +1,174 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimaprowcache.h"
+
+#include <QtGlobal>
+
+namespace Minimap {
+namespace Internal {
+
+void MinimapRowCache::reset(int rowCount, int width)
+{
+    m_width = qMax(0, width);
+    m_infos.assign(qMax(0, rowCount), RowInfo());
+    m_pixels.assign(m_infos.size() * m_width, 0);
+}
+
+void MinimapRowCache::insertRows(int at, int count)
+{
+    if (count <= 0) {
+        return;
+    }
+    at = qBound(0, at, rowCount());
+    m_infos.insert(m_infos.begin() + at, count, RowInfo());
+    m_pixels.insert(m_pixels.begin() + static_cast<size_t>(at) * m_width,
+                    static_cast<size_t>(count) * m_width,
+                    0);
+}
+
+void MinimapRowCache::removeRows(int at, int count)
+{
+    at = qBound(0, at, rowCount());
+    count = qMin(count, rowCount() - at);
+    if (count <= 0) {
+        return;
+    }
+    m_infos.erase(m_infos.begin() + at, m_infos.begin() + at + count);
+    m_pixels.erase(m_pixels.begin() + static_cast<size_t>(at) * m_width,
+                   m_pixels.begin() + static_cast<size_t>(at + count) * m_width);
+}
+
+void MinimapRowCache::invalidate(int from, int count)
+{
+    from = qBound(0, from, rowCount());
+    int to = qBound(from, from + count, rowCount());
+    for (int i = from; i < to; ++i) {
+        m_infos[i].valid = false;
+        m_infos[i].current = false;
+    }
+}
+
+void MinimapRowCache::invalidateAll()
+{
+    for (RowInfo &info : m_infos) {
+        info.valid = false;
+        info.current = false;
+    }
+}
+
+void MinimapRowCache::setCurrent(int row)
+{
+    if (row >= 0 && row < rowCount()) {
+        m_infos[row].current = true;
+    }
+}
+
+void MinimapRowCache::markStale(int from, int count)
+{
+    from = qBound(0, from, rowCount());
+    int to = qBound(from, from + count, rowCount());
+    for (int i = from; i < to; ++i) {
+        m_infos[i].current = false;
+    }
+}
+
+void MinimapRowCache::markStale()
+{
+    for (RowInfo &info : m_infos) {
+        info.current = false;
+    }
+}
+
+bool MinimapRowCache::isValid(int row, uint signature) const
+{
+    if (row < 0 || row >= rowCount()) {
+        return false;
+    }
+    const RowInfo &info = m_infos[row];
+    return info.valid && info.signature == signature;
+}
+
+bool MinimapRowCache::isProvisional(int row) const
+{
+    return row >= 0 && row < rowCount() && m_infos[row].provisional;
+}
+
+int MinimapRowCache::extent(int row) const
+{
+    return row >= 0 && row < rowCount() ? m_infos[row].extent : 0;
+}
+
+void MinimapRowCache::setValid(int row, uint signature, bool provisional, int extent)
+{
+    if (row < 0 || row >= rowCount()) {
+        return;
+    }
+    RowInfo &info = m_infos[row];
+    info.signature = signature;
+    info.extent = extent;
+    info.valid = true;
+    info.provisional = provisional;
+    info.seeded = false;
+    info.source = -1;
+    info.current = true;
+}
+
+bool MinimapRowCache::isSeeded(int row) const
+{
+    return row >= 0 && row < rowCount() && m_infos[row].seeded;
+}
+
+int MinimapRowCache::seedSource(int row) const
+{
+    return row >= 0 && row < rowCount() ? m_infos[row].source : -1;
+}
+
+void MinimapRowCache::setSeedLoaded(int row)
+{
+    if (row >= 0 && row < rowCount()) {
+        m_infos[row].source = -1;
+    }
+}
+
+bool MinimapRowCache::isSeeded(int row, uint textHash) const
+{
+    if (row < 0 || row >= rowCount()) {
+        return false;
+    }
+    const RowInfo &info = m_infos[row];
+    return info.seeded && info.seed == textHash;
+}
+
+void MinimapRowCache::setSeeded(int row, uint textHash, int extent, int source)
+{
+    if (row < 0 || row >= rowCount()) {
+        return;
+    }
+    RowInfo &info = m_infos[row];
+    info.seed = textHash;
+    info.extent = extent;
+    info.source = source;
+    info.valid = false;
+    info.seeded = true;
+    info.current = false;
+}
+} // namespace Internal
+} // namespace Minimap
@@ -0,0 +1,104 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include <QRgb>
+
+#include <vector>
+
+namespace Minimap {
+namespace Internal {
+
+//! Rasterized rows of a document, one row per text block.
+//!
+//! Every row holds width() pixels. Ink pixels are stored with an opaque
+//! alpha value, background pixels with a transparent one, which allows rows
+//! to be blended onto each other after they have been cached. The extent
+//! of a row is the number of pixels covered by the text of its block.
+class MinimapRowCache
+{
+public:
+    void reset(int rowCount, int width);
+
+    int rowCount() const { return static_cast<int>(m_infos.size()); }
+    int width() const { return m_width; }
+
+    void insertRows(int at, int count);
+    void removeRows(int at, int count);
+    void invalidate(int from, int count);
+    void invalidateAll();
+
+    bool isValid(int row, uint signature) const;
+    bool isProvisional(int row) const;
+
+    //! Current rows are known to match their blocks without looking at their
+    //! signature, nothing touched their block since they were rasterized or
+    //! their seed was accepted. Invalidating a row makes it not current.
+    bool isCurrent(int row) const { return m_infos[row].current; }
+    void setCurrent(int row);
+    //! Makes @a count rows from @a from, or every row, prove themselves by
+    //! their signature again, without invalidating them.
+    void markStale(int from, int count);
+    void markStale();
+
+    int extent(int row) const;
+    void setValid(int row, uint signature, bool provisional, int extent);
+
+    //! Seeded rows were restored from the disk cache. They are used in place
+    //! of provisional rows as long as the text of their block is unchanged.
+    //! Their pixels are read from row seedSource() of the disk cache entry
+    //! when they are first used, until then the source is not negative.
+    bool isSeeded(int row) const;
+    bool isSeeded(int row, uint textHash) const;
+    void setSeeded(int row, uint textHash, int extent, int source);
+    int seedSource(int row) const;
+    void setSeedLoaded(int row);
+
+    QRgb *row(int row) { return m_pixels.data() + static_cast<size_t>(row) * m_width; }
+    const QRgb *row(int row) const
+    {
+        return m_pixels.data() + static_cast<size_t>(row) * m_width;
+    }
+
+private:
+    struct RowInfo
+    {
+        uint signature = 0;
+        uint seed = 0;
+        int extent = 0;
+        int source = -1;
+        bool valid = false;
+        bool provisional = false;
+        bool seeded = false;
+        bool current = false;
+    };
+
+    int m_width = 0;
+    std::vector<QRgb> m_pixels;
+    std::vector<RowInfo> m_infos;
+};
+
+inline bool isInk(QRgb pixel)
+{
+    return qAlpha(pixel) != 0;
+}
+} // namespace Internal
+} // namespace Minimap
@@ -0,0 +1,250 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimapsearch.h"
+
+#include "minimapconstants.h"
+#include "minimapmirror.h"
+
+#include <algorithm>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MINIMAP_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MINIMAP_NEON
+#endif
+
+namespace Minimap {
+namespace Internal {
+namespace {
+//! Returns true if @a c may be part of a word, like the find toolbar does.
+inline bool isWordCharacter(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+//! Returns a bit for each of the 8 characters at @a u that equals @a lower
+//! or @a upper.
+inline quint32 matchFirst8(const char16_t *u, char16_t lower, char16_t upper)
+{
+#if defined(MINIMAP_SSE2)
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u));
+    const __m128i eq = _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16(static_cast<short>(lower))),
+                                    _mm_cmpeq_epi16(v, _mm_set1_epi16(static_cast<short>(upper))));
+    return static_cast<quint32>(_mm_movemask_epi8(_mm_packs_epi16(eq, _mm_setzero_si128())));
+#elif defined(MINIMAP_NEON)
+    static const uint16_t weights[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+    const uint16x8_t v = vld1q_u16(reinterpret_cast<const uint16_t *>(u));
+    const uint16x8_t eq = vorrq_u16(vceqq_u16(v, vdupq_n_u16(lower)),
+                                    vceqq_u16(v, vdupq_n_u16(upper)));
+    return static_cast<quint32>(vaddvq_u16(vandq_u16(eq, vld1q_u16(weights))));
+#else
+    quint32 mask(0);
+    for (int i = 0; i < 8; ++i) {
+        if (u[i] == lower || u[i] == upper) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+} // namespace
+
+void findMatches(QStringView text,
+                 QStringView needle,
+                 Qt::CaseSensitivity cs,
+                 bool wholeWords,
+                 QList<int> &positions)
+{
+    const qsizetype n = needle.size();
+    if (n == 0 || text.size() < n) {
+        return;
+    }
+    const char16_t *u = text.utf16();
+    const QChar first = needle.front();
+    const char16_t lower = cs == Qt::CaseSensitive ? first.unicode() : first.toLower().unicode();
+    const char16_t upper = cs == Qt::CaseSensitive ? first.unicode() : first.toUpper().unicode();
+    // candidates are found by their first character, verified in full and
+    // skipped while they overlap the previous match
+    const qsizetype end = text.size() - n + 1;
+    qsizetype next(0);
+    auto verify = [&](qsizetype i) {
+        if (wholeWords
+            && ((i > 0 && isWordCharacter(text.at(i - 1)))
+                || (i + n < text.size() && isWordCharacter(text.at(i + n))))) {
+            return;
+        }
+        if (i >= next && text.sliced(i, n).compare(needle, cs) == 0) {
+            positions.append(static_cast<int>(i));
+            next = i + n;
+        }
+    };
+    qsizetype i(0);
+    for (; i + 8 <= end; i += 8) {
+        for (quint32 mask = matchFirst8(u + i, lower, upper); mask; mask &= mask - 1) {
+            verify(i + std::countr_zero(mask));
+        }
+    }
+    for (; i < end; ++i) {
+        if (u[i] == lower || u[i] == upper) {
+            verify(i);
+        }
+    }
+}
+
+bool MinimapSearchLayer::setTerm(const QString &term,
+                                 Qt::CaseSensitivity cs,
+                                 bool wholeWords,
+                                 bool regularExpression,
+                                 QRgb color,
+                                 const MinimapSnapshot &snapshot)
+{
+    if (term == m_term && cs == m_cs && wholeWords == m_wholeWords
+        && regularExpression == m_regularExpression && color == m_color) {
+        return false;
+    }
+    const bool hadHits = m_hitCount > 0;
+    m_term = term;
+    m_cs = cs;
+    m_wholeWords = wholeWords;
+    m_regularExpression = regularExpression;
+    m_color = color;
+    m_pattern = QRegularExpression();
+    if (regularExpression && !term.isEmpty()) {
+        m_pattern.setPattern(wholeWords ? QStringLiteral("\\b(?:%1)\\b").arg(term) : term);
+        m_pattern.setPatternOptions(cs == Qt::CaseSensitive
+                                        ? QRegularExpression::NoPatternOption
+                                        : QRegularExpression::CaseInsensitiveOption);
+        if (!m_pattern.isValid()) {
+            // nothing to mark while a pattern is being typed
+            m_term.clear();
+        }
+    }
+    rescan(snapshot, m_tab, m_compression);
+    return hadHits || m_hitCount > 0;
+}
+
+void MinimapSearchLayer::rescan(const MinimapSnapshot &snapshot, int tab, int compression)
+{
+    m_tab = tab;
+    m_compression = qMax(1, compression);
+    m_hits.clear();
+    m_hitCount = 0;
+    m_hits.resize(snapshot.lineCount());
+    if (!m_term.isEmpty()) {
+        for (int n = 0; n < lineCount(); ++n) {
+            scanLine(snapshot, n);
+        }
+    }
+    invalidateAll();
+}
+
+void MinimapSearchLayer::contentsChange(const MinimapSnapshot &snapshot, int first, int last)
+{
+    const int delta = snapshot.lineCount() - lineCount();
+    if (first < 0 || first >= snapshot.lineCount() || first + 1 > lineCount()) {
+        rescan(snapshot, m_tab, m_compression);
+        return;
+    }
+    if (delta > 0) {
+        m_hits.insert(first + 1, delta, QList<Hit>());
+    } else if (delta < 0) {
+        for (int n = first + 1; n < first + 1 - delta; ++n) {
+            m_hitCount -= static_cast<int>(m_hits.at(n).size());
+        }
+        m_hits.remove(first + 1, -delta);
+    }
+    last = qMin(last, lineCount() - 1);
+    for (int n = first; n <= last; ++n) {
+        if (!m_term.isEmpty() || !m_hits.at(n).isEmpty()) {
+            scanLine(snapshot, n);
+            invalidateBlock(n);
+        }
+    }
+    if (delta != 0 && m_hitCount > 0) {
+        // the blocks behind the change moved
+        invalidateAll();
+    }
+}
+
+bool MinimapSearchLayer::drawBlock(int block, QRgb *line, int width, int scale)
+{
+    if (block >= lineCount()) {
+        return false;
+    }
+    const QList<Hit> &hits = m_hits.at(block);
+    for (const Hit &hit : hits) {
+        const int begin = (Constants::MINIMAP_EXTRA_AREA_WIDTH + hit.x) * scale;
+        const int end = qMin(width, begin + qMax(1, hit.width) * scale);
+        if (begin < end) {
+            std::fill(line + begin, line + end, m_color);
+        }
+    }
+    return !hits.isEmpty();
+}
+
+void MinimapSearchLayer::scanLine(const MinimapSnapshot &snapshot, int n)
+{
+    QList<Hit> &hits = m_hits[n];
+    m_hitCount -= static_cast<int>(hits.size());
+    hits.clear();
+    if (m_term.isEmpty()) {
+        return;
+    }
+    const QString &text = snapshot.line(n).text;
+    // map characters to columns the way the rasterizer expands tabs, hits
+    // are appended from left to right
+    int column(0);
+    int c(0);
+    auto advance = [&](int to) {
+        for (; c < to; ++c) {
+            column += text.at(c) == QChar::Tabulation ? m_tab : 1;
+        }
+    };
+    auto addHit = [&](int start, int length) {
+        advance(start);
+        const int x = column;
+        advance(start + length);
+        const int k = m_compression;
+        hits.append(Hit{x / k, (column + k - 1) / k - x / k});
+    };
+    if (m_regularExpression) {
+        for (auto it = m_pattern.globalMatch(text); it.hasNext();) {
+            const QRegularExpressionMatch match = it.next();
+            // empty matches, as of "a*", have nothing to mark
+            if (match.capturedLength() > 0) {
+                addHit(static_cast<int>(match.capturedStart()),
+                       static_cast<int>(match.capturedLength()));
+            }
+        }
+    } else {
+        m_positions.clear();
+        findMatches(text, m_term, m_cs, m_wholeWords, m_positions);
+        for (int start : std::as_const(m_positions)) {
+            addHit(start, static_cast<int>(m_term.size()));
+        }
+    }
+    m_hitCount += static_cast<int>(hits.size());
+}
+} // namespace Internal
+} // namespace Minimap
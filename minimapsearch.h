@@ -0,0 +1,101 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include "minimaplayer.h"
+
+#include <QList>
+#include <QRegularExpression>
+#include <QRgb>
+#include <QString>
+#include <QStringView>
+
+namespace Minimap {
+namespace Internal {
+
+struct MinimapSnapshot;
+
+//! Appends the start of every non-overlapping occurrence of @a needle in
+//! @a text to @a positions. With @a wholeWords occurrences that are part of
+//! a longer word are skipped.
+void findMatches(QStringView text,
+                 QStringView needle,
+                 Qt::CaseSensitivity cs,
+                 bool wholeWords,
+                 QList<int> &positions);
+
+//! Marks the occurrences of a term, like the one of the find toolbar or the
+//! word under the cursor, on top of the minimap text.
+//!
+//! The hits are kept per block and scanned from the document mirror, so an
+//! edit only rescans the blocks it touched.
+class MinimapSearchLayer : public MinimapLayer
+{
+public:
+    //! Sets the term to mark and rescans @a snapshot if anything changed.
+    //! Returns true if it did. With @a wholeWords only whole words are
+    //! marked, with @a regularExpression the term is a pattern and matches
+    //! of any length are marked.
+    bool setTerm(const QString &term,
+                 Qt::CaseSensitivity cs,
+                 bool wholeWords,
+                 bool regularExpression,
+                 QRgb color,
+                 const MinimapSnapshot &snapshot);
+
+    //! Rescans every line of @a snapshot, for rows expanding tabs to @a tab
+    //! columns and averaging @a compression columns into one pixel.
+    void rescan(const MinimapSnapshot &snapshot, int tab, int compression);
+
+    //! Follows a change of the lines @a first to @a last of @a snapshot.
+    //! Lines inserted or removed are assumed to follow @a first.
+    void contentsChange(const MinimapSnapshot &snapshot, int first, int last);
+
+    int lineCount() const { return static_cast<int>(m_hits.size()); }
+
+protected:
+    bool hasContent() const override { return m_hitCount > 0; }
+    bool drawBlock(int block, QRgb *line, int width, int scale) override;
+
+private:
+    //! A hit, in minimap columns.
+    struct Hit
+    {
+        int x;
+        int width;
+    };
+
+    void scanLine(const MinimapSnapshot &snapshot, int n);
+
+    QList<QList<Hit>> m_hits;
+    QList<int> m_positions;
+    QString m_term;
+    QRegularExpression m_pattern; //!< the term, if it is a regular expression
+    Qt::CaseSensitivity m_cs = Qt::CaseSensitive;
+    bool m_wholeWords = false;
+    bool m_regularExpression = false;
+    QRgb m_color = 0;
+    int m_tab = 0;
+    int m_compression = 1;
+    int m_hitCount = 0;
+};
+} // namespace Internal
+} // namespace Minimap
@@ -50,8 +50,16 @@ const char lineCountThresholdKey[] = "LineCountThresHold";
 const char alphaKey[] = "Alpha";
 const char centerOnClickKey[] = "CenterOnClick";
 const char showLineTooltipKey[] = "ShowLineTooltip";
+const char showHoverLensKey[] = "ShowHoverLens";
 const char pixelsPerLineKey[] = "PixelsPerLine";
 const char styleKey[] = "DisplayStyle";
+const char structuralScaleKey[] = "StructuralScale";
+const char downsamplingKey[] = "Downsampling";
+const char compressLongLinesKey[] = "CompressLongLines";
+const char diskCacheSizeKey[] = "DiskCacheSize";
+const char prerenderMemoryKey[] = "PrerenderMemory";
+const char renderBudgetKey[] = "RenderBudget";
+const char traceEventsKey[] = "TraceEvents";
 
 MinimapSettings *m_instance = 0;
 } // namespace
@@ -105,6 +113,11 @@ public:
             Tr::tr("Show line range tooltip when interacting with minimap"));
         m_showLineTooltip->setChecked(m_instance->m_showLineTooltip);
         form->addRow(Tr::tr("Show line tooltip:"), m_showLineTooltip);
+        m_showHoverLens = new QCheckBox(groupBox);
+        m_showHoverLens->setToolTip(
+            Tr::tr("Show a magnified preview of the lines under the mouse when hovering the minimap"));
+        m_showHoverLens->setChecked(m_instance->m_showHoverLens);
+        form->addRow(Tr::tr("Show hover lens:"), m_showHoverLens);
         m_pixelsPerLine = new QSpinBox;
         m_pixelsPerLine->setMinimum(1);
         m_pixelsPerLine->setMaximum(std::numeric_limits<int>::max());
@@ -115,8 +128,70 @@ public:
         m_styleComboBox = new QComboBox;
         m_styleComboBox->addItem(Tr::tr("scale minimap to editor height"), static_cast<int>(EMinimapStyle::eScaling));
         m_styleComboBox->addItem(Tr::tr("scroll minimap"), static_cast<int>(EMinimapStyle::eScrolling));
+        m_styleComboBox->addItem(Tr::tr("scale minimap, draw structure when zoomed out"),
+                                 static_cast<int>(EMinimapStyle::eStructural));
         m_styleComboBox->setCurrentIndex(m_styleComboBox->findData(static_cast<int>(m_instance->m_style)));
         form->addRow(Tr::tr("Display behaviour for large documents:"), m_styleComboBox);
+        m_structuralScale = new QSpinBox;
+        m_structuralScale->setMinimum(1);
+        m_structuralScale->setMaximum(100);
+        m_structuralScale->setSuffix(Tr::tr(" %"));
+        m_structuralScale->setToolTip(
+            Tr::tr("Scale below which lines are drawn as indentation and token bars, "
+                   "when drawing structure is chosen"));
+        m_structuralScale->setValue(m_instance->m_structuralScale);
+        form->addRow(Tr::tr("Structure below scale:"), m_structuralScale);
+        m_downsamplingComboBox = new QComboBox;
+        m_downsamplingComboBox->addItem(Tr::tr("average"),
+                                        static_cast<int>(EMinimapDownsampling::eAverage));
+        m_downsamplingComboBox->addItem(Tr::tr("strongest ink"),
+                                        static_cast<int>(EMinimapDownsampling::eMaxInk));
+        m_downsamplingComboBox->addItem(Tr::tr("first line"),
+                                        static_cast<int>(EMinimapDownsampling::eRepresentative));
+        m_downsamplingComboBox->setToolTip(
+            Tr::tr("How lines sharing a pixel row are merged when the minimap is scaled"));
+        m_downsamplingComboBox->setCurrentIndex(
+            m_downsamplingComboBox->findData(static_cast<int>(m_instance->m_downsampling)));
+        form->addRow(Tr::tr("Downsampling:"), m_downsamplingComboBox);
+        m_compressLongLines = new QCheckBox(groupBox);
+        m_compressLongLines->setToolTip(
+            Tr::tr("Squeeze documents with lines wider than the minimap into its width "
+                   "instead of cutting the lines off, up to four characters per pixel. "
+                   "Lines more than four times as wide as the minimap are still cut off."));
+        m_compressLongLines->setChecked(m_instance->m_compressLongLines);
+        form->addRow(Tr::tr("Compress long lines:"), m_compressLongLines);
+        m_diskCacheSize = new QSpinBox;
+        m_diskCacheSize->setMinimum(0);
+        m_diskCacheSize->setMaximum(std::numeric_limits<int>::max());
+        m_diskCacheSize->setSuffix(Tr::tr(" MiB"));
+        m_diskCacheSize->setToolTip(
+            Tr::tr("Size of the on-disk cache of rendered minimaps, 0 disables the cache"));
+        m_diskCacheSize->setValue(m_instance->m_diskCacheSize);
+        form->addRow(Tr::tr("Disk cache size:"), m_diskCacheSize);
+        m_prerenderMemory = new QSpinBox;
+        m_prerenderMemory->setMinimum(0);
+        m_prerenderMemory->setMaximum(std::numeric_limits<int>::max());
+        m_prerenderMemory->setSuffix(Tr::tr(" MiB"));
+        m_prerenderMemory->setToolTip(
+            Tr::tr("Memory for minimaps of background editors prepared while idle, "
+                   "0 disables preparing them"));
+        m_prerenderMemory->setValue(m_instance->m_prerenderMemory);
+        form->addRow(Tr::tr("Background render memory:"), m_prerenderMemory);
+        m_renderBudget = new QSpinBox;
+        m_renderBudget->setMinimum(0);
+        m_renderBudget->setMaximum(1000);
+        m_renderBudget->setSuffix(Tr::tr(" ms"));
+        m_renderBudget->setToolTip(
+            Tr::tr("Time a minimap frame may take before the level of detail is reduced, "
+                   "0 always renders full detail"));
+        m_renderBudget->setValue(m_instance->m_renderBudget);
+        form->addRow(Tr::tr("Render time budget:"), m_renderBudget);
+        m_traceEvents = new QCheckBox(groupBox);
+        m_traceEvents->setToolTip(
+            Tr::tr("Write Chrome trace events of the minimap's work to a JSON file "
+                   "in the minimap directory of the user resources"));
+        m_traceEvents->setChecked(m_instance->m_traceEvents);
+        form->addRow(Tr::tr("Record trace events:"), m_traceEvents);
 
         groupBox->setLayout(form);
         setLayout(layout);
@@ -152,6 +227,10 @@ public:
             m_instance->setShowLineTooltip(m_showLineTooltip->isChecked());
             save = true;
         }
+        if (m_showHoverLens->isChecked() != MinimapSettings::showHoverLens()) {
+            m_instance->setShowHoverLens(m_showHoverLens->isChecked());
+            save = true;
+        }
         if (m_pixelsPerLine->value() != MinimapSettings::pixelsPerLine()) {
             m_instance->setPixelsPerLine(m_pixelsPerLine->value());
             save = true;
@@ -160,6 +239,36 @@ public:
             m_instance->setStyle(static_cast<EMinimapStyle>(m_styleComboBox->currentData().toInt()));
             save = true;
         }
+        if (m_structuralScale->value() != MinimapSettings::structuralScale()) {
+            m_instance->setStructuralScale(m_structuralScale->value());
+            save = true;
+        }
+        if (static_cast<EMinimapDownsampling>(m_downsamplingComboBox->currentData().toInt())
+            != MinimapSettings::downsampling()) {
+            m_instance->setDownsampling(
+                static_cast<EMinimapDownsampling>(m_downsamplingComboBox->currentData().toInt()));
+            save = true;
+        }
+        if (m_compressLongLines->isChecked() != MinimapSettings::compressLongLines()) {
+            m_instance->setCompressLongLines(m_compressLongLines->isChecked());
+            save = true;
+        }
+        if (m_diskCacheSize->value() != MinimapSettings::diskCacheSize()) {
+            m_instance->setDiskCacheSize(m_diskCacheSize->value());
+            save = true;
+        }
+        if (m_prerenderMemory->value() != MinimapSettings::prerenderMemory()) {
+            m_instance->setPrerenderMemory(m_prerenderMemory->value());
+            save = true;
+        }
+        if (m_renderBudget->value() != MinimapSettings::renderBudget()) {
+            m_instance->setRenderBudget(m_renderBudget->value());
+            save = true;
+        }
+        if (m_traceEvents->isChecked() != MinimapSettings::traceEvents()) {
+            m_instance->setTraceEvents(m_traceEvents->isChecked());
+            save = true;
+        }
         if (save) {
             Utils::storeToSettings(Utils::keyFromString(minimapPostFix),
                                    Core::ICore::settings(),
@@ -182,8 +291,16 @@ private:
     QSpinBox *m_alpha;
     QCheckBox *m_centerOnClick;
     QCheckBox *m_showLineTooltip;
+    QCheckBox *m_showHoverLens;
     QSpinBox *m_pixelsPerLine;
     QComboBox* m_styleComboBox;
+    QSpinBox *m_structuralScale;
+    QComboBox *m_downsamplingComboBox;
+    QCheckBox *m_compressLongLines;
+    QSpinBox *m_diskCacheSize;
+    QSpinBox *m_prerenderMemory;
+    QSpinBox *m_renderBudget;
+    QCheckBox *m_traceEvents;
     bool m_textWrapping;
 };
 
@@ -207,8 +324,16 @@ MinimapSettings::MinimapSettings(QObject *parent)
     , m_alpha(Constants::MINIMAP_ALPHA_DEFAULT)
     , m_centerOnClick(Constants::MINIMAP_CENTER_ON_CLICK_DEFAULT)
     , m_showLineTooltip(Constants::MINIMAP_SHOW_LINE_TOOLTIP_DEFAULT)
+    , m_showHoverLens(Constants::MINIMAP_SHOW_HOVER_LENS_DEFAULT)
     , m_pixelsPerLine(Constants::MINIMAP_PIXELS_PER_LINE_DEFAULT)
     , m_style(Constants::MINIMAP_STYLE_DEFAULT)
+    , m_structuralScale(Constants::MINIMAP_STRUCTURAL_SCALE_DEFAULT)
+    , m_downsampling(Constants::MINIMAP_DOWNSAMPLING_DEFAULT)
+    , m_compressLongLines(Constants::MINIMAP_COMPRESS_LONG_LINES_DEFAULT)
+    , m_diskCacheSize(Constants::MINIMAP_DISK_CACHE_SIZE_DEFAULT)
+    , m_prerenderMemory(Constants::MINIMAP_PRERENDER_MEMORY_DEFAULT)
+    , m_renderBudget(Constants::MINIMAP_RENDER_BUDGET_DEFAULT)
+    , m_traceEvents(Constants::MINIMAP_TRACE_EVENTS_DEFAULT)
 {
     QTC_ASSERT(!m_instance, return);
     m_instance = this;
@@ -235,8 +360,16 @@ Utils::Store MinimapSettings::toMap() const
     map.insert(alphaKey, m_alpha);
     map.insert(centerOnClickKey, m_centerOnClick);
     map.insert(showLineTooltipKey, m_showLineTooltip);
+    map.insert(showHoverLensKey, m_showHoverLens);
     map.insert(pixelsPerLineKey, m_pixelsPerLine);
     map.insert(styleKey, static_cast<int>(m_style));
+    map.insert(structuralScaleKey, m_structuralScale);
+    map.insert(downsamplingKey, static_cast<int>(m_downsampling));
+    map.insert(compressLongLinesKey, m_compressLongLines);
+    map.insert(diskCacheSizeKey, m_diskCacheSize);
+    map.insert(prerenderMemoryKey, m_prerenderMemory);
+    map.insert(renderBudgetKey, m_renderBudget);
+    map.insert(traceEventsKey, m_traceEvents);
     return map;
 }
 
@@ -248,8 +381,17 @@ void MinimapSettings::fromMap(const Utils::Store &map)
     m_alpha = map.value(alphaKey, m_alpha).toInt();
     m_centerOnClick = map.value(centerOnClickKey, m_centerOnClick).toBool();
     m_showLineTooltip = map.value(showLineTooltipKey, m_showLineTooltip).toBool();
+    m_showHoverLens = map.value(showHoverLensKey, m_showHoverLens).toBool();
     m_pixelsPerLine = map.value(pixelsPerLineKey, m_pixelsPerLine).toInt();
     m_style = static_cast<EMinimapStyle>(map.value(styleKey, static_cast<int>(m_style)).toInt());
+    m_structuralScale = map.value(structuralScaleKey, m_structuralScale).toInt();
+    m_downsampling = static_cast<EMinimapDownsampling>(
+        map.value(downsamplingKey, static_cast<int>(m_downsampling)).toInt());
+    m_compressLongLines = map.value(compressLongLinesKey, m_compressLongLines).toBool();
+    m_diskCacheSize = map.value(diskCacheSizeKey, m_diskCacheSize).toInt();
+    m_prerenderMemory = map.value(prerenderMemoryKey, m_prerenderMemory).toInt();
+    m_renderBudget = map.value(renderBudgetKey, m_renderBudget).toInt();
+    m_traceEvents = map.value(traceEventsKey, m_traceEvents).toBool();
 }
 
 bool MinimapSettings::enabled()
@@ -282,6 +424,11 @@ bool MinimapSettings::showLineTooltip()
     return m_instance->m_showLineTooltip;
 }
 
+bool MinimapSettings::showHoverLens()
+{
+    return m_instance->m_showHoverLens;
+}
+
 int MinimapSettings::pixelsPerLine()
 {
     return m_instance->m_pixelsPerLine;
@@ -292,6 +439,41 @@ EMinimapStyle MinimapSettings::style()
     return m_instance->m_style;
 }
 
+int MinimapSettings::structuralScale()
+{
+    return m_instance->m_structuralScale;
+}
+
+EMinimapDownsampling MinimapSettings::downsampling()
+{
+    return m_instance->m_downsampling;
+}
+
+bool MinimapSettings::compressLongLines()
+{
+    return m_instance->m_compressLongLines;
+}
+
+int MinimapSettings::diskCacheSize()
+{
+    return m_instance->m_diskCacheSize;
+}
+
+int MinimapSettings::prerenderMemory()
+{
+    return m_instance->m_prerenderMemory;
+}
+
+int MinimapSettings::renderBudget()
+{
+    return m_instance->m_renderBudget;
+}
+
+bool MinimapSettings::traceEvents()
+{
+    return m_instance->m_traceEvents;
+}
+
 void MinimapSettings::setEnabled(bool enabled)
 {
     if (m_enabled != enabled) {
@@ -340,6 +522,14 @@ void MinimapSettings::setShowLineTooltip(bool showLineTooltip)
     }
 }
 
+void MinimapSettings::setShowHoverLens(bool showHoverLens)
+{
+    if (m_showHoverLens != showHoverLens) {
+        m_showHoverLens = showHoverLens;
+        emit showHoverLensChanged(showHoverLens);
+    }
+}
+
 void MinimapSettings::setPixelsPerLine(int pixelsPerLine)
 {
     if (m_pixelsPerLine != pixelsPerLine) {
@@ -355,5 +545,61 @@ void MinimapSettings::setStyle(EMinimapStyle style)
         emit styleChanged(style);
     }
 }
+
+void MinimapSettings::setStructuralScale(int structuralScale)
+{
+    if (m_structuralScale != structuralScale) {
+        m_structuralScale = structuralScale;
+        emit structuralScaleChanged(structuralScale);
+    }
+}
+
+void MinimapSettings::setDownsampling(EMinimapDownsampling downsampling)
+{
+    if (m_downsampling != downsampling) {
+        m_downsampling = downsampling;
+        emit downsamplingChanged(downsampling);
+    }
+}
+
+void MinimapSettings::setCompressLongLines(bool compressLongLines)
+{
+    if (m_compressLongLines != compressLongLines) {
+        m_compressLongLines = compressLongLines;
+        emit compressLongLinesChanged(compressLongLines);
+    }
+}
+
+void MinimapSettings::setDiskCacheSize(int diskCacheSize)
+{
+    if (m_diskCacheSize != diskCacheSize) {
+        m_diskCacheSize = diskCacheSize;
+        emit diskCacheSizeChanged(diskCacheSize);
+    }
+}
+
+void MinimapSettings::setPrerenderMemory(int prerenderMemory)
+{
+    if (m_prerenderMemory != prerenderMemory) {
+        m_prerenderMemory = prerenderMemory;
+        emit prerenderMemoryChanged(prerenderMemory);
+    }
+}
+
+void MinimapSettings::setRenderBudget(int renderBudget)
+{
+    if (m_renderBudget != renderBudget) {
+        m_renderBudget = renderBudget;
+        emit renderBudgetChanged(renderBudget);
+    }
+}
+
+void MinimapSettings::setTraceEvents(bool traceEvents)
+{
+    if (m_traceEvents != traceEvents) {
+        m_traceEvents = traceEvents;
+        emit traceEventsChanged(traceEvents);
+    }
+}
 } // namespace Internal
 } // namespace Minimap
@@ -48,8 +48,16 @@ public:
     static int alpha();
     static bool centerOnClick();
     static bool showLineTooltip();
+    static bool showHoverLens();
     static int pixelsPerLine();
     static EMinimapStyle style();
+    static int structuralScale();
+    static EMinimapDownsampling downsampling();
+    static bool compressLongLines();
+    static int diskCacheSize();
+    static int prerenderMemory();
+    static int renderBudget();
+    static bool traceEvents();
 
 signals:
     void enabledChanged(bool);
@@ -58,8 +66,16 @@ signals:
     void alphaChanged(int);
     void centerOnClickChanged(bool);
     void showLineTooltipChanged(bool);
+    void showHoverLensChanged(bool);
     void pixelsPerLineChanged(int);
     void styleChanged(Minimap::EMinimapStyle);
+    void structuralScaleChanged(int);
+    void downsamplingChanged(Minimap::EMinimapDownsampling);
+    void compressLongLinesChanged(bool);
+    void diskCacheSizeChanged(int);
+    void prerenderMemoryChanged(int);
+    void renderBudgetChanged(int);
+    void traceEventsChanged(bool);
 
 private:
     friend class MinimapSettingsPageWidget;
@@ -70,8 +86,16 @@ private:
     void setAlpha(int alpha);
     void setCenterOnClick(bool centerOnClick);
     void setShowLineTooltip(bool showLineTooltip);
+    void setShowHoverLens(bool showHoverLens);
     void setPixelsPerLine(int pixelsPerLine);
     void setStyle(EMinimapStyle style);
+    void setStructuralScale(int structuralScale);
+    void setDownsampling(EMinimapDownsampling downsampling);
+    void setCompressLongLines(bool compressLongLines);
+    void setDiskCacheSize(int diskCacheSize);
+    void setPrerenderMemory(int prerenderMemory);
+    void setRenderBudget(int renderBudget);
+    void setTraceEvents(bool traceEvents);
 
     bool m_enabled;
     int m_width;
@@ -79,8 +103,16 @@ private:
     int m_alpha;
     bool m_centerOnClick;
     bool m_showLineTooltip;
+    bool m_showHoverLens;
     int m_pixelsPerLine;
     EMinimapStyle m_style;
+    int m_structuralScale;
+    EMinimapDownsampling m_downsampling;
+    bool m_compressLongLines;
+    int m_diskCacheSize;
+    int m_prerenderMemory;
+    int m_renderBudget;
+    bool m_traceEvents;
     MinimapSettingsPage *m_settingsPage;
 };
 } // namespace Internal
@@ -20,6 +20,10 @@
 
 #include "minimapstyle.h"
 
+#include <aggregation/aggregate.h>
+#include <coreplugin/editormanager/editormanager.h>
+#include <coreplugin/editormanager/ieditor.h>
+#include <coreplugin/find/basetextfind.h>
 #include <texteditor/displaysettings.h>
 #include <texteditor/fontsettings.h>
 #include <texteditor/tabsettings.h>
@@ -27,113 +31,204 @@
 #include <texteditor/textdocumentlayout.h>
 #include <texteditor/texteditor.h>
 #include <texteditor/texteditorsettings.h>
+#include <texteditor/textmark.h>
 #include <utils/theme/theme.h>
 
 #include <algorithm>
+#include <array>
+#include <optional>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QMouseEvent>
+#include <QPaintEngine>
 #include <QPainter>
+#include <QPixmap>
+#include <QPointer>
+#include <QScreen>
 #include <QScrollBar>
+#include <QSet>
 #include <QStyleOption>
+#include <QtConcurrent>
+#include <QTextCursor>
 #include <QTextBlock>
 #include <QTextDocument>
+#include <QThread>
 #include <QTimer>
 #include <QToolTip>
 
+#include "minimapaccumulator.h"
 #include "minimapconstants.h"
+#include "minimapdiskcache.h"
+#include "minimapgovernor.h"
+#include "minimapgutter.h"
+#include "minimaplayer.h"
+#include "minimaplens.h"
+#include "minimapmarkers.h"
+#include "minimapmirror.h"
+#include "minimapprerenderer.h"
+#include "minimaprasterizer.h"
+#include "minimaprowcache.h"
+#include "minimapsearch.h"
 #include "minimapsettings.h"
+#include "minimaptrace.h"
 
 namespace Minimap {
 namespace Internal {
 namespace {
-const QRgb black = QColor(Qt::black).rgb();
-const QRgb red = QColor(Qt::red).rgb();
-const QRgb green = QColor(Qt::darkGreen).rgb();
-
-inline QColor blendColors(const QColor &a, const QColor &b)
-{
-    int c = qMin(255, a.cyan() + b.cyan());
-    int m = qMin(255, a.magenta() + b.magenta());
-    int y = qMin(255, a.yellow() + b.yellow());
-    int k = qMin(255, a.black() + b.black());
-    return QColor::fromCmyk(c, m, y, k);
-}
-
-inline bool updatePixel(QRgb *scanLine,
-                        bool blend,
-                        const QChar &c,
-                        int &x,
-                        int w,
-                        int tab,
-                        const QColor &bg,
-                        const QColor &fg)
+//! Returns the part of @a rect the current paint event asked for, in the
+//! logical coordinates of @a painter.
+QRect exposedRect(const QPainter *painter, const QRect &rect)
 {
-    if (c == QChar::Tabulation) {
-        for (int i = 0; i < tab; ++i) {
-            if (!blend) {
-                scanLine[x++] = bg.rgb();
-            }
-            if (x >= w) {
-                return false;
-            }
-        }
-    } else {
-        bool isSpace = c.isSpace();
-        if (blend && !isSpace) {
-            QColor result = blendColors(fg.toCmyk(), QColor(scanLine[x]).toCmyk()).toRgb();
-            scanLine[x++] = result.rgb();
-        } else {
-            scanLine[x++] = isSpace ? bg.rgb() : fg.rgb();
-        }
-        if (x >= w) {
-            return false;
-        }
+    const QPaintEngine *engine = painter->paintEngine();
+    if (!engine || engine->systemClip().isEmpty()) {
+        return rect;
     }
-    return true;
+    bool invertible(false);
+    const QTransform toLogical = painter->deviceTransform().inverted(&invertible);
+    if (!invertible) {
+        return rect;
+    }
+    return toLogical.map(engine->systemClip()).boundingRect().intersected(rect);
 }
 
-inline void merge(QColor &bg, QColor &fg, const QTextCharFormat &f)
+// smallest number of rows worth handing to another thread
+const int minimumBandSize = 256;
+// blocks prepared in the background before the cost of a block is known
+const int prerenderProbeBlocks = 16;
+// longest time an invalidation may wait for a burst of them to settle
+const qint64 maxUpdateDelay = 250; // ms
+// time without resize events after which a resize is considered finished
+const int resizeSettleDelay = 150; // ms
+// largest image rendered at device resolution, in device pixels
+const qint64 maxDeviceImagePixels = 8 * 1024 * 1024;
+// most characters averaged into one pixel when compressing long lines, lines
+// wider than this many minimap widths are cut off as documented for the setting
+const int maxCompression = 4;
+// row caches kept per detail, indexed by the detail they were rasterized at
+const int parkedDetails = static_cast<int>(EMinimapDetail::eDensity) + 1;
+// opacity of search hits and occurrences drawn over the text
+const int searchHitAlpha = 160;
+// time the cursor has to rest before the occurrences of its word are marked
+const int occurrenceDelay = 250; // ms
+// lines previewed by the hover lens
+const int lensLines = 32;
+// width and height in pixels of a character cell of the hover lens
+const int lensZoom = 2;
+const int lensLineHeight = 4;
+// distance between the hover lens and the minimap
+const int lensMargin = 8;
+
+//! Copies @a w pixels of @a src, widening each of them to @a scale pixels.
+inline void copyRow(QRgb *dst, const QRgb *src, int w, int scale)
 {
-    if (f.background().style() != Qt::NoBrush) {
-        bg = f.background().color();
+    if (scale == 1) {
+        for (int x = 0; x < w; ++x) {
+            dst[x] = src[x] | 0xff000000;
+        }
+        return;
     }
-    if (f.foreground().style() != Qt::NoBrush) {
-        fg = f.foreground().color();
+    for (int x = 0; x < w; ++x) {
+        std::fill(dst + x * scale, dst + (x + 1) * scale, src[x] | 0xff000000);
     }
 }
 } // namespace
 
-class MinimapStyleObject : public QObject
+class MinimapStyleObject : public QObject, public MinimapPrerenderable
 {
 public:
     MinimapStyleObject(TextEditor::BaseTextEditor *editor)
         : QObject(editor->editorWidget())
         , m_theme(Utils::creatorTheme())
         , m_editor(editor->editorWidget())
+        , m_factor(1.0)
+        , m_lineCount(0)
         , m_update(false)
         , m_isDragging(false)
+        , m_initialized(false)
+        , m_dormant(false)
+        , m_rowTab(0)
+        , m_highlighted(false)
+        , m_diskCacheChecked(false)
+        , m_rowDetail(EMinimapDetail::eFull)
+        , m_rowStructural(false)
+        , m_rowCompression(1)
+        , m_dirtyFirst(-1)
+        , m_dirtyLast(-1)
+        , m_resizing(false)
+        , m_renderedHeight(0)
+        , m_geometryWidth(-1)
+        , m_imageScale(1)
+        , m_frameDirty(true)
+        , m_frameKey(0)
+        , m_blockCount(0)
+        , m_markersPending(false)
+        , m_gutterKey(0)
+        , m_gutterStale(true)
+        , m_gutterFirst(-1)
+        , m_gutterLast(-1)
+        , m_prerendered(false)
+        , m_prerenderNext(0)
     {
+        m_updateTimer.setSingleShot(true);
+        connect(&m_updateTimer, &QTimer::timeout, this, &MinimapStyleObject::performUpdate);
+        m_resizeTimer.setSingleShot(true);
+        connect(&m_resizeTimer, &QTimer::timeout, this, &MinimapStyleObject::resizeSettled);
+        m_lensTimer.setSingleShot(true);
+        connect(&m_lensTimer, &QTimer::timeout, this, &MinimapStyleObject::updateLens);
+        m_occurrenceTimer.setSingleShot(true);
+        m_occurrenceTimer.setInterval(occurrenceDelay);
+        connect(&m_occurrenceTimer,
+                &QTimer::timeout,
+                this,
+                &MinimapStyleObject::updateSearchTerm);
+
+        // Editors restored into background tabs might never be shown, so
+        // the actual setup is deferred until the scrollbar becomes visible.
         m_editor->installEventFilter(this);
-        if (!m_editor->textDocument()->document()->isEmpty()) {
-            init();
-        } else {
-            connect(m_editor->textDocument()->document(),
-                    &QTextDocument::contentsChanged,
-                    this,
-                    &MinimapStyleObject::contentsChanged);
+        m_editor->verticalScrollBar()->installEventFilter(this);
+        initWhenReady();
+        if (!m_initialized) {
+            if (auto prerenderer = MinimapPrerenderer::instance()) {
+                prerenderer->add(this);
+            }
         }
     }
 
-    ~MinimapStyleObject() { m_editor->removeEventFilter(this); }
+    ~MinimapStyleObject()
+    {
+        if (auto prerenderer = MinimapPrerenderer::instance()) {
+            prerenderer->remove(this);
+        }
+        m_editor->removeEventFilter(this);
+    }
 
     bool eventFilter(QObject *watched, QEvent *event)
     {
+        if (!m_initialized) {
+            if (watched == m_editor->verticalScrollBar() && event->type() == QEvent::Show) {
+                initWhenReady();
+            }
+            return false;
+        }
+
         if (watched == m_editor && event->type() == QEvent::Resize) {
-            deferedUpdate();
+            editorResized();
             return false;
         }
 
         if (watched == m_editor->verticalScrollBar()) {
+            if (event->type() == QEvent::HoverMove) {
+                hoverMoved(static_cast<QHoverEvent *>(event)->position().toPoint());
+            } else if (event->type() == QEvent::HoverLeave
+                       || event->type() == QEvent::MouseButtonPress) {
+                hideLens();
+            }
+            if (m_recorder
+                && (event->type() == QEvent::MouseButtonPress
+                    || event->type() == QEvent::MouseButtonRelease
+                    || event->type() == QEvent::MouseMove)) {
+                m_recorder->mouse(static_cast<QMouseEvent *>(event));
+            }
             if (event->type() == QEvent::MouseButtonPress) {
                 QMouseEvent *mouseEvent = static_cast<QMouseEvent *>(event);
                 if (mouseEvent->button() == Qt::LeftButton) {
@@ -209,6 +304,13 @@ public:
 
     int lineCount() const { return m_lineCount; }
 
+    //! Returns true if the scrollbar should be replaced by the minimap.
+    bool minimapVisible() const
+    {
+        return m_lineCount > 0 && m_lineCount <= MinimapSettings::lineCountThreshold()
+               && m_governor.detail() != EMinimapDetail::eNone;
+    }
+
     qreal factor() const { return m_factor; }
 
     const QColor &background() const { return m_backgroundColor; }
@@ -219,30 +321,186 @@ public:
 
     TextEditor::TextEditorWidget *editor() const { return m_editor; }
 
-    const QImage& minimapImage() const { return m_image; }
+    //! The composited minimap, refreshed only when the frame changes.
+    const QPixmap &minimapPixmap() const { return m_pixmap; }
+
+    //! Renders the minimap image and feeds the time it took to the governor.
+    //! While the editor is being resized, the last frame is kept and shown
+    //! rescaled instead. Paints that do not change the frame, like exposes
+    //! and tooltips, reuse the pixmap without rendering.
+    bool drawMinimap(const QScrollBar *scrollbar)
+    {
+        if (isPlaceholder()) {
+            return true;
+        }
+        const size_t key = frameKey();
+        if (!m_frameDirty && key == m_frameKey && !m_pixmap.isNull()) {
+            updateLayers();
+            return true;
+        }
+
+        // render into the older buffer, the newer one tells what changed
+        m_image.swap(m_previousImage);
+        if (m_image.size() != m_previousImage.size()) {
+            m_image = QImage(m_previousImage.size(), QImage::Format_RGB32);
+            m_image.setDevicePixelRatio(m_previousImage.devicePixelRatio());
+        }
+        QElapsedTimer timer;
+        timer.start();
+        const bool drawn = renderMinimap(scrollbar);
+        if (!drawn) {
+            m_image.swap(m_previousImage);
+            return false;
+        }
+        m_renderedHeight = m_editor->height();
+        if (m_governor.addFrame(timer.nsecsElapsed())) {
+            // the geometry must not change while painting
+            deferedUpdate();
+        } else {
+            m_frameDirty = false;
+        }
+        m_frameKey = key;
+        uploadFrame();
+        updateLayers();
+        return true;
+    }
 
-    virtual bool drawMinimap(const QScrollBar *scrollbar) = 0;
+#ifdef WITH_TESTS
+    //! Renders a frame even though nothing changed.
+    bool renderFrame()
+    {
+        m_frameDirty = true;
+        return drawMinimap(m_editor->verticalScrollBar());
+    }
+#endif
+
+    //! Draws the layers composited on top of the text into @a target.
+    void drawLayers(QPainter *painter, const QRect &target) const
+    {
+        const QRect source = imageSourceRect(target);
+        if (m_gutter.isVisible()) {
+            painter->drawPixmap(target, m_gutter.pixmap(), source);
+        }
+        if (m_search.isVisible()) {
+            painter->drawPixmap(target, m_search.pixmap(), source);
+        }
+        if (m_markers.isVisible()) {
+            painter->drawPixmap(target, m_markers.pixmap(), source);
+        }
+    }
+
+    //! Returns true if the image is the rescaled frame of a previous size.
+    bool isPlaceholder() const
+    {
+        return m_resizing && !m_image.isNull() && m_renderedHeight > 0;
+    }
+
+    //! Returns the part of the minimap image to draw into @a target.
+    QRect imageSourceRect(const QRect &target) const
+    {
+        // the image is addressed in device pixels
+        const int s = m_imageScale;
+        if (!isPlaceholder() || m_editor->height() <= 0) {
+            return QRect(target.topLeft() * s, target.size() * s);
+        }
+        const qreal sy = m_renderedHeight / static_cast<qreal>(m_editor->height());
+        return QRect(target.x() * s,
+                     qRound(target.y() * sy * s),
+                     target.width() * s,
+                     qMax(1, qRound(target.height() * sy * s)));
+    }
 private:
+    //! Brings the layers up to date with the layout of the last frame.
+    void updateLayers()
+    {
+        MinimapTraceScope scope("layers");
+        const size_t key = gutterKey();
+        if (key != m_gutterKey && m_mirror.lineCount() > 0) {
+            // a save changes the gutter only, the text stays as it is
+            m_mirror.refreshFlags(m_editor->document());
+            m_gutterStale = true;
+        }
+        m_gutterKey = key;
+        if (m_gutterStale) {
+            m_gutterStale = false;
+            m_gutter.sync(m_mirror.current(),
+                          m_editor->revisionsVisible(),
+                          m_editor->codeFoldingVisible());
+        } else if (m_gutterFirst >= 0) {
+            m_gutter.sync(m_mirror.current(),
+                          m_editor->revisionsVisible(),
+                          m_editor->codeFoldingVisible(),
+                          m_gutterFirst,
+                          m_gutterLast);
+        }
+        m_gutterFirst = m_gutterLast = -1;
+        m_gutter.update(m_layout, m_image.size(), m_image.devicePixelRatio());
+        m_search.update(m_layout, m_image.size(), m_image.devicePixelRatio());
+        m_markers.update(m_layout, m_image.size(), m_image.devicePixelRatio());
+    }
+
+    void initWhenReady()
+    {
+        if (m_initialized || !m_editor->verticalScrollBar()->isVisible()) {
+            return;
+        }
+        if (m_editor->textDocument()->document()->isEmpty()) {
+            connect(m_editor->textDocument()->document(),
+                    &QTextDocument::contentsChanged,
+                    this,
+                    &MinimapStyleObject::contentsChanged,
+                    Qt::UniqueConnection);
+            return;
+        }
+        init();
+    }
+
     void init()
     {
+        m_initialized = true;
+        if (auto prerenderer = MinimapPrerenderer::instance()) {
+            prerenderer->remove(this);
+        }
+        disconnect(m_editor->textDocument(),
+                   &TextEditor::TextDocument::fontSettingsChanged,
+                   this,
+                   &MinimapStyleObject::backgroundFontSettingsChanged);
         QScrollBar *scrollbar = m_editor->verticalScrollBar();
         scrollbar->setProperty(Constants::MINIMAP_STYLE_OBJECT_PROPERTY,
                                QVariant::fromValue<QObject *>(this));
 
-        scrollbar->installEventFilter(this);
-
         connect(m_editor->textDocument(),
                 &TextEditor::TextDocument::fontSettingsChanged,
                 this,
                 &MinimapStyleObject::fontSettingsChanged);
-        connect(m_editor->document()->documentLayout(),
-                &QAbstractTextDocumentLayout::documentSizeChanged,
+        connect(Core::EditorManager::instance(),
+                &Core::EditorManager::editorAboutToClose,
                 this,
-                &MinimapStyleObject::deferedUpdate);
-        connect(m_editor->document()->documentLayout(),
-                &QAbstractTextDocumentLayout::update,
+                &MinimapStyleObject::editorAboutToClose);
+        connectDocument();
+        connect(m_editor,
+                &QPlainTextEdit::cursorPositionChanged,
                 this,
-                &MinimapStyleObject::deferedUpdate);
+                &MinimapStyleObject::cursorPositionChanged);
+        if (auto find = qobject_cast<Core::BaseTextFind *>(
+                Aggregation::query<Core::IFindSupport>(m_editor))) {
+            connect(find,
+                    &Core::BaseTextFind::highlightAllRequested,
+                    this,
+                    [this](const QString &txt, Utils::FindFlags findFlags) {
+                        m_findTerm = txt;
+                        m_findFlags = findFlags;
+                        updateSearchTerm();
+                    });
+        }
+        m_recorder = MinimapTraceRecorder::create(m_editor);
+        if (m_recorder) {
+            // recorded even while dormant, unlike the document hooks
+            connect(m_editor->document(),
+                    &QTextDocument::contentsChange,
+                    this,
+                    &MinimapStyleObject::recordContentsChange);
+        }
         connect(MinimapSettings::instance(),
                 &MinimapSettings::enabledChanged,
                 this,
@@ -267,16 +525,130 @@ private:
                 &MinimapSettings::showLineTooltipChanged,
                 this,
                 &MinimapStyleObject::showLineTooltipChanged);
+        connect(MinimapSettings::instance(),
+                &MinimapSettings::showHoverLensChanged,
+                this,
+                &MinimapStyleObject::hideLens);
         connect(scrollbar,
                 &QAbstractSlider::valueChanged,
                 this,
-                &MinimapStyleObject::updateSubControlRects);
+                &MinimapStyleObject::scrollbarValueChanged);
+        // hover events drive the lens, independent of mouse tracking
+        scrollbar->setAttribute(Qt::WA_Hover);
         connect(MinimapSettings::instance(),
                 &MinimapSettings::pixelsPerLineChanged,
                 this,
                 &MinimapStyleObject::deferedUpdate);
+        connect(MinimapSettings::instance(),
+                &MinimapSettings::structuralScaleChanged,
+                this,
+                &MinimapStyleObject::deferedUpdate);
+        connect(MinimapSettings::instance(),
+                &MinimapSettings::compressLongLinesChanged,
+                this,
+                &MinimapStyleObject::deferedUpdate);
+        connect(MinimapSettings::instance(),
+                &MinimapSettings::downsamplingChanged,
+                this,
+                &MinimapStyleObject::deferedUpdate);
+        connect(MinimapSettings::instance(),
+                &MinimapSettings::renderBudgetChanged,
+                this,
+                &MinimapStyleObject::renderBudgetChanged);
+
+        if (m_prerendered) {
+            // the rows prepared in the background match the font settings,
+            // laying out right away lets the first paint show them
+            updateColors();
+            updateSearchTerm();
+            performUpdate();
+        } else {
+            fontSettingsChanged();
+        }
+    }
 
-        fontSettingsChanged();
+    //! Prepares the rows of the minimap of an editor that was not shown yet,
+    //! in bands small enough to keep the slices of the prerenderer short.
+    //! The frame itself is left to the first paint, which only has to
+    //! compose the rows then.
+    bool prerender(const QDeadlineTimer &deadline) override
+    {
+        QTextDocument *doc = m_editor->document();
+        const int w = width() - Constants::MINIMAP_EXTRA_AREA_WIDTH;
+        if (m_initialized || !MinimapSettings::enabled() || doc->isEmpty() || w <= 0
+            || lineCountFor(doc->blockCount()) > MinimapSettings::lineCountThreshold()) {
+            return true;
+        }
+        MinimapTraceScope scope("prerender");
+        if (!m_prerendered) {
+            m_prerendered = true;
+            m_prerenderNext = 0;
+            updateColors();
+            connect(m_editor->textDocument(),
+                    &TextEditor::TextDocument::fontSettingsChanged,
+                    this,
+                    &MinimapStyleObject::backgroundFontSettingsChanged,
+                    Qt::UniqueConnection);
+        }
+        ensureRowCache(w, expectsStructuralRows());
+        const int first = m_prerenderNext;
+        QTextBlock b = doc->findBlockByNumber(m_prerenderNext);
+        // bands are sized by the measured cost of a block, so the last one
+        // ends close to the deadline instead of up to a full band after it
+        int bandSize(prerenderProbeBlocks);
+        QElapsedTimer timer;
+        while (b.isValid() && !deadline.hasExpired()) {
+            timer.start();
+            prepareRows(b, bandSize);
+            const qint64 elapsed = qMax<qint64>(1, timer.nsecsElapsed());
+            m_prerenderNext += bandSize;
+            b = doc->findBlockByNumber(m_prerenderNext);
+            const qint64 remaining = deadline.remainingTimeNSecs();
+            bandSize = remaining < 0 ? minimumBandSize
+                                     : static_cast<int>(qBound<qint64>(1,
+                                                                      remaining * bandSize / elapsed,
+                                                                      minimumBandSize));
+        }
+        scope.setBlocks(qMin(m_prerenderNext, doc->blockCount()) - first);
+        return !b.isValid();
+    }
+
+    qint64 prerenderedBytes() const override
+    {
+        qint64 bytes = qint64(m_rows.rowCount()) * m_rows.width() * sizeof(QRgb);
+        for (const MinimapRowCache &rows : m_parkedRows) {
+            bytes += qint64(rows.rowCount()) * rows.width() * sizeof(QRgb);
+        }
+        if (m_mirror.lineCount() > 0) {
+            bytes += qint64(m_mirror.lineCount()) * sizeof(MinimapMirrorLine)
+                     + qint64(m_editor->document()->characterCount()) * sizeof(QChar);
+        }
+        return bytes;
+    }
+
+    void dropPrerendered() override
+    {
+        disconnect(m_editor->textDocument(),
+                   &TextEditor::TextDocument::fontSettingsChanged,
+                   this,
+                   &MinimapStyleObject::backgroundFontSettingsChanged);
+        m_prerendered = false;
+        m_rows.reset(0, 0);
+        m_diskRows.reset();
+        dropParkedRows();
+        m_mirror.clear();
+        m_search.clear();
+        // the first frame looks at the disk cache again
+        m_diskCacheChecked = false;
+    }
+
+    //! The colors of the prepared rows are outdated, they are prepared anew.
+    void backgroundFontSettingsChanged()
+    {
+        dropPrerendered();
+        if (auto prerenderer = MinimapPrerenderer::instance()) {
+            prerenderer->add(this);
+        }
     }
 
     virtual void centerViewportOnMousePosition(const QPoint &mousePos) = 0;
@@ -314,6 +686,118 @@ private:
         QToolTip::showText(globalPos, tooltipText, m_editor->verticalScrollBar());
     }
 
+    void hoverMoved(const QPoint &pos)
+    {
+        if (!MinimapSettings::showHoverLens() || m_isDragging || m_dormant || !minimapVisible()) {
+            hideLens();
+            return;
+        }
+        m_lensPos = pos;
+        // follow the mouse at most once per display frame
+        if (!m_lensTimer.isActive()) {
+            m_lensTimer.start(frameInterval());
+        }
+    }
+
+    void hideLens()
+    {
+        m_lensTimer.stop();
+        if (m_lens) {
+            m_lens->hide();
+        }
+    }
+
+    //! Shows the lines around the mouse magnified, rasterized from the
+    //! mirrored lines with an outline for every character.
+    void updateLens()
+    {
+        QTextDocument *doc = m_editor->document();
+        const int center = blockAt(m_lensPos.y());
+        if (center < 0 || m_rows.width() <= 0 || m_mirror.lineCount() != doc->blockCount()) {
+            hideLens();
+            return;
+        }
+        MinimapTraceScope scope("lens");
+        const QTextBlock centerBlock = doc->findBlockByNumber(center);
+        QTextBlock first = centerBlock;
+        for (int i = 0; i < lensLines / 2 && first.previous().isValid();) {
+            first = first.previous();
+            if (first.isVisible()) {
+                ++i;
+            }
+        }
+
+        const int w = m_rows.width();
+        QImage image(w * lensZoom, lensLines * lensLineHeight, QImage::Format_RGB32);
+        image.fill(m_backgroundColor);
+        int n(0);
+        int centerLine(-1);
+        for (QTextBlock b = first; b.isValid() && n < lensLines; b = b.next()) {
+            if (!b.isVisible()) {
+                continue;
+            }
+            // at full detail whatever the governor chose for the minimap
+            const int number = b.blockNumber();
+            const bool pending = m_highlighted && isHighlightPending(b);
+            syncMirrorLine(b, number, RowState{pending, pending, blockSignature(b, pending)});
+            m_arena.reset();
+            MinimapLine &line = m_arena.nextLine();
+            MinimapDocumentMirror::resolve(m_mirror.current(), number, line);
+            rasterizeGlyphs(line,
+                            reinterpret_cast<QRgb *>(image.scanLine(n * lensLineHeight)),
+                            image.bytesPerLine() / qsizetype(sizeof(QRgb)),
+                            w,
+                            lensZoom,
+                            lensLineHeight,
+                            m_rowTab,
+                            m_palette);
+            if (b == centerBlock) {
+                centerLine = n;
+            }
+            ++n;
+        }
+        scope.setBlocks(n);
+        scope.setPixels(qint64(image.width()) * image.height());
+        if (centerLine >= 0) {
+            QPainter painter(&image);
+            painter.fillRect(0, centerLine * lensLineHeight, image.width(), lensLineHeight, m_overlayColor);
+        }
+
+        if (!m_lens) {
+            m_lens = new MinimapLens(m_editor);
+        }
+        QScrollBar *scrollbar = m_editor->verticalScrollBar();
+        m_lens->showImage(image, scrollbar->mapToGlobal(QPoint(-lensMargin, m_lensPos.y())));
+    }
+
+    //! Returns the block drawn at @a y of the minimap, or -1 if there is none.
+    int blockAt(int y) const
+    {
+        const int deviceY = imageSourceRect(QRect(0, y, 1, 1)).y();
+        const QList<int> &tops = m_layout.tops;
+        // the tops of the visible blocks grow, look for the first one below
+        // deviceY, probing the next visible block where one is hidden
+        int lo(0);
+        int hi(static_cast<int>(tops.size()));
+        while (lo < hi) {
+            const int mid = lo + (hi - lo) / 2;
+            int probe = mid;
+            while (probe < hi && tops.at(probe) == MinimapLayout::hidden) {
+                ++probe;
+            }
+            if (probe == hi || tops.at(probe) > deviceY) {
+                hi = mid;
+            } else {
+                lo = probe + 1;
+            }
+        }
+        int block = lo - 1;
+        while (block >= 0 && tops.at(block) == MinimapLayout::hidden) {
+            --block;
+        }
+        return block;
+    }
+
     QPair<int, int> getVisibleLineRange() const
     {
         QRect viewport = m_editor->viewport()->rect();
@@ -339,10 +823,21 @@ private:
                    &QTextDocument::contentsChanged,
                    this,
                    &MinimapStyleObject::contentsChanged);
-        init();
+        initWhenReady();
     }
 
     void fontSettingsChanged()
+    {
+        updateColors();
+        m_rows.invalidateAll();
+        dropParkedRows();
+        m_mirror.clear();
+        updateSearchTerm();
+        deferedUpdate();
+    }
+
+    //! Resolves the colors of the minimap from the font settings.
+    void updateColors()
     {
         const TextEditor::FontSettings &settings = m_editor->textDocument()->fontSettings();
         m_backgroundColor = settings.formatFor(TextEditor::C_TEXT).background();
@@ -359,23 +854,900 @@ private:
             m_overlayColor = QColor(Qt::black);
         }
         m_overlayColor.setAlpha(MinimapSettings::alpha());
+
+        m_palette.background = m_backgroundColor;
+        m_palette.foreground = m_foregroundColor;
+        m_palette.punctuation = settings.formatFor(TextEditor::C_PUNCTUATION).foreground();
+        if (!m_palette.punctuation.isValid()) {
+            m_palette.punctuation = m_foregroundColor;
+        }
+        m_palette.comment = settings.formatFor(TextEditor::C_COMMENT).foreground();
+        if (!m_palette.comment.isValid()) {
+            m_palette.comment = m_foregroundColor;
+        }
+        m_searchColor = settings.formatFor(TextEditor::C_SEARCH_RESULT).background();
+        if (!m_searchColor.isValid()) {
+            m_searchColor = m_theme->color(Utils::Theme::TextColorHighlightBackground);
+        }
+        m_occurrenceColor = settings.formatFor(TextEditor::C_OCCURRENCES).background();
+        if (!m_occurrenceColor.isValid()) {
+            m_occurrenceColor = m_searchColor;
+        }
+    }
+
+    //! Marks the term of the find toolbar, or the word under the cursor
+    //! while there is none.
+    //! The word under the cursor changes with every keystroke while typing,
+    //! its occurrences are only looked up once the cursor rests.
+    void cursorPositionChanged()
+    {
+        if (m_findTerm.isEmpty()) {
+            m_occurrenceTimer.start();
+        }
+    }
+
+    void updateSearchTerm()
+    {
+        m_occurrenceTimer.stop();
+        QString term = m_findTerm;
+        QColor color = m_searchColor;
+        // marked the way the find toolbar highlights its matches
+        Qt::CaseSensitivity cs = m_findFlags & Utils::FindCaseSensitively ? Qt::CaseSensitive
+                                                                          : Qt::CaseInsensitive;
+        bool wholeWords = m_findFlags & Utils::FindWholeWords;
+        bool regularExpression = m_findFlags & Utils::FindRegularExpression;
+        if (term.isEmpty()) {
+            QTextCursor cursor = m_editor->textCursor();
+            if (!cursor.hasSelection()) {
+                cursor.select(QTextCursor::WordUnderCursor);
+                term = cursor.selectedText();
+            }
+            // a single character or an operator would light up everything
+            if (term.size() < 2 || !term.front().isLetterOrNumber()) {
+                term.clear();
+            }
+            color = m_occurrenceColor;
+            cs = Qt::CaseSensitive;
+            wholeWords = false;
+            regularExpression = false;
+        }
+        color.setAlpha(searchHitAlpha);
+        if (m_search.setTerm(term,
+                             cs,
+                             wholeWords,
+                             regularExpression,
+                             qPremultiply(color.rgba()),
+                             m_mirror.current())
+            && !m_dormant) {
+            m_editor->verticalScrollBar()->update();
+        }
+    }
+
+    void documentContentsChange(int position, int charsRemoved, int charsAdded)
+    {
+        QTextDocument *doc = m_editor->document();
+        m_mirror.contentsChange(doc, position, charsRemoved, charsAdded);
+        const int firstRow = doc->findBlock(position).blockNumber();
+        const int lastRow = qMax(firstRow, doc->findBlock(position + charsAdded).blockNumber());
+        const int lineDelta = doc->blockCount() - m_blockCount;
+        // marks move with their blocks, the document only notifies when it
+        // moves them differently
+        m_markers.blocksChanged(firstRow, lineDelta);
+        m_gutter.blocksChanged(firstRow, lineDelta);
+        m_blockCount = doc->blockCount();
+        if (lineDelta != 0 && m_gutterFirst >= 0) {
+            if (m_gutterFirst > firstRow) {
+                m_gutterFirst = qMax(firstRow, m_gutterFirst + lineDelta);
+            }
+            if (m_gutterLast > firstRow) {
+                m_gutterLast = qMax(firstRow, m_gutterLast + lineDelta);
+            }
+        }
+        if (m_mirror.lineCount() > 0) {
+            // the mirror recaptured the revisions of the changed lines
+            markGutterDirty(firstRow, lastRow);
+            m_search.contentsChange(m_mirror.current(), firstRow, lastRow);
+        }
+        if (m_rows.rowCount() == 0) {
+            return;
+        }
+        // keep the cached rows aligned with their blocks
+        if (firstRow < 0) {
+            m_rows.reset(doc->blockCount(), m_rows.width());
+            return;
+        }
+        const int delta = doc->blockCount() - m_rows.rowCount();
+        for (MinimapRowCache *rows : rowCaches()) {
+            if (rows->rowCount() + delta != doc->blockCount()) {
+                // parked rows of an earlier layout are of no use any more
+                *rows = MinimapRowCache();
+            } else if (delta > 0) {
+                rows->insertRows(firstRow + 1, delta);
+            } else if (delta < 0) {
+                rows->removeRows(firstRow + 1, -delta);
+            }
+        }
+        if (delta != 0 && m_dirtyFirst >= 0) {
+            // the pending range moves along with the rows behind the change
+            if (m_dirtyFirst > firstRow) {
+                m_dirtyFirst = qMax(firstRow, m_dirtyFirst + delta);
+            }
+            if (m_dirtyLast > firstRow) {
+                m_dirtyLast = qMax(firstRow, m_dirtyLast + delta);
+            }
+        }
+        markDirty(firstRow, lastRow);
+        deferedUpdate();
+    }
+
+    //! Returns a value covering the state a frame depends on that does not
+    //! notify the style object when it changes.
+    size_t frameKey() const
+    {
+        return qHashMulti(0,
+                          m_editor->document()->revision(),
+                          TextEditor::TextEditorSettings::displaySettings().m_textWrapping);
+    }
+
+    //! Returns a value covering the state the gutter depends on that does
+    //! not notify the style object when it changes, like saving.
+    size_t gutterKey() const
+    {
+        auto documentLayout = qobject_cast<TextEditor::TextDocumentLayout *>(
+            m_editor->document()->documentLayout());
+        return qHashMulti(0,
+                          documentLayout ? documentLayout->lastSaveRevision : 0,
+                          m_editor->revisionsVisible(),
+                          m_editor->codeFoldingVisible());
+    }
+
+    //! Brings the pixmap up to date with the image, uploading only the bands
+    //! of scan lines that differ from the previous frame.
+    void uploadFrame()
+    {
+        MinimapTraceScope scope("upload");
+        const QSize size = m_image.size();
+        if (m_pixmap.isNull() || m_pixmap.size() != size || m_previousImage.size() != size
+            || m_pixmap.devicePixelRatio() != m_image.devicePixelRatio()) {
+            m_pixmap = QPixmap::fromImage(m_image);
+            scope.setPixels(qint64(size.width()) * size.height());
+            return;
+        }
+        qint64 uploaded(0);
+        const qreal dpr = m_image.devicePixelRatio();
+        const qsizetype bytes = m_image.bytesPerLine();
+        auto changed = [&](int y) {
+            return memcmp(m_image.constScanLine(y), m_previousImage.constScanLine(y), bytes) != 0;
+        };
+        // a frame that did not change does not even need a painter
+        std::optional<QPainter> painter;
+        for (int y = 0; y < size.height();) {
+            if (!changed(y)) {
+                ++y;
+                continue;
+            }
+            int end = y + 1;
+            while (end < size.height() && changed(end)) {
+                ++end;
+            }
+            if (!painter) {
+                painter.emplace(&m_pixmap);
+                painter->setCompositionMode(QPainter::CompositionMode_Source);
+            }
+            const QRect source(0, y, size.width(), end - y);
+            painter->drawImage(QRectF(source.topLeft() / dpr, source.size() / dpr), m_image, source);
+            uploaded += qint64(source.width()) * source.height();
+            y = end;
+        }
+        scope.setPixels(uploaded);
+    }
+
+    void recordContentsChange(int position, int charsRemoved, int charsAdded)
+    {
+        m_recorder->contentsChange(m_editor->document(), position, charsRemoved, charsAdded);
+    }
+
+    void editorResized()
+    {
+        if (m_recorder) {
+            m_recorder->resize(m_editor->size());
+        }
+        m_resizing = true;
+        m_resizeTimer.start(resizeSettleDelay);
         deferedUpdate();
     }
 
+    void resizeSettled()
+    {
+        m_resizing = false;
+        deferedUpdate();
+    }
+
+    //! Adds the rows @a first to @a last to the range invalidated by the next update.
+    void markDirty(int first, int last)
+    {
+        if (m_dirtyFirst < 0) {
+            m_dirtyFirst = first;
+            m_dirtyLast = last;
+        } else {
+            m_dirtyFirst = qMin(m_dirtyFirst, first);
+            m_dirtyLast = qMax(m_dirtyLast, last);
+        }
+    }
+
+    //! Adds the lines @a first to @a last to the range of the gutter synced
+    //! by the next update.
+    void markGutterDirty(int first, int last)
+    {
+        if (m_gutterFirst < 0) {
+            m_gutterFirst = first;
+            m_gutterLast = last;
+        } else {
+            m_gutterFirst = qMin(m_gutterFirst, first);
+            m_gutterLast = qMax(m_gutterLast, last);
+        }
+    }
+
+    //! Refreshes the flags of the blocks a fold starting at @a blockNumber
+    //! shows or hides.
+    void foldChanged(int blockNumber)
+    {
+        const QTextBlock block = m_editor->document()->findBlockByNumber(blockNumber);
+        if (!block.isValid() || m_mirror.lineCount() == 0) {
+            return;
+        }
+        // a fold covers the blocks following it that are indented deeper
+        const int indent = TextEditor::TextDocumentLayout::foldingIndent(block);
+        int last = blockNumber;
+        for (QTextBlock b = block.next();
+             b.isValid() && TextEditor::TextDocumentLayout::foldingIndent(b) > indent;
+             b = b.next()) {
+            last = b.blockNumber();
+        }
+        m_mirror.refreshFlags(m_editor->document(), blockNumber, last);
+        markGutterDirty(blockNumber, last);
+        deferedUpdate();
+    }
+
+    void flushDirtyRows()
+    {
+        if (m_dirtyFirst >= 0 && m_dirtyFirst < m_rows.rowCount()) {
+            const int last = qMin(m_dirtyLast, m_rows.rowCount() - 1);
+            // the signatures tell which of them really changed, highlighters
+            // mark many blocks dirty whose formats stay the same
+            m_rows.markStale(m_dirtyFirst, last - m_dirtyFirst + 1);
+        }
+        m_dirtyFirst = m_dirtyLast = -1;
+    }
+
+    //! Schedules an update. Invalidations arriving in bursts, like those of
+    //! highlighters or typing, are merged until none came in for a display
+    //! frame, but are not held back longer than maxUpdateDelay.
     void deferedUpdate()
     {
-        if (m_update) {
+        MinimapTraceScope scope("deferedUpdate");
+        m_frameDirty = true;
+        if (!m_update) {
+            m_update = true;
+            m_pendingSince.start();
+        }
+        const qint64 remaining = qMax(qint64(0), maxUpdateDelay - m_pendingSince.elapsed());
+        m_updateTimer.start(static_cast<int>(qMin(qint64(frameInterval()), remaining)));
+    }
+
+    int frameInterval() const
+    {
+        const QScreen *screen = m_editor->screen();
+        const qreal rate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60.0;
+        return qMax(1, qRound(1000 / rate));
+    }
+
+    void performUpdate()
+    {
+        QElapsedTimer timer;
+        timer.start();
+        flushDirtyRows();
+        const int lineCount = lineCountFor(m_editor->document()->blockCount());
+        setDormant(lineCount > MinimapSettings::lineCountThreshold());
+        if (m_dormant) {
+            m_lineCount = lineCount;
+            m_update = false;
+        } else {
+            // a minimap switched off by the governor is not painted and thus
+            // never measured, give it another chance from time to time
+            m_governor.probe();
+            MinimapTraceScope scope("update");
+            scope.setBlocks(m_editor->document()->blockCount());
+            update();
+        }
+        MinimapTraceReplay::addSample(m_editor, MinimapTraceReplay::Sample::Update, timer.nsecsElapsed());
+    }
+
+    void renderBudgetChanged()
+    {
+        m_governor.reset();
+        deferedUpdate();
+    }
+
+    //! A dormant style object is over the line count threshold. It holds no
+    //! image or rows and only watches the block count to wake up again.
+    void setDormant(bool dormant)
+    {
+        if (m_dormant == dormant) {
             return;
         }
-        m_update = true;
-        QTimer::singleShot(0, this, &MinimapStyleObject::update);
+        m_dormant = dormant;
+        QTextDocument *doc = m_editor->document();
+        if (dormant) {
+            hideLens();
+            disconnectDocument();
+            connect(doc,
+                    &QTextDocument::blockCountChanged,
+                    this,
+                    &MinimapStyleObject::dormantBlockCountChanged);
+            m_image = QImage();
+            m_previousImage = QImage();
+            m_pixmap = QPixmap();
+            m_rows.reset(0, 0);
+            m_diskRows.reset();
+            dropParkedRows();
+            m_mirror.clear();
+            m_search.clear();
+            m_markers.clearMarkers();
+            m_markers.clear();
+            m_gutter.clear();
+            m_dirtyFirst = m_dirtyLast = -1;
+            m_groove = m_addPage = m_subPage = m_slider = QRect();
+            m_geometryWidth = 0;
+            m_editor->verticalScrollBar()->updateGeometry();
+        } else {
+            disconnect(doc,
+                       &QTextDocument::blockCountChanged,
+                       this,
+                       &MinimapStyleObject::dormantBlockCountChanged);
+            connectDocument();
+        }
+    }
+
+    void dormantBlockCountChanged(int blockCount)
+    {
+        if (lineCountFor(blockCount) <= MinimapSettings::lineCountThreshold()) {
+            deferedUpdate();
+        }
+    }
+
+    void connectDocument()
+    {
+        QTextDocument *doc = m_editor->document();
+        connect(doc,
+                &QTextDocument::contentsChange,
+                this,
+                &MinimapStyleObject::documentContentsChange);
+        m_blockCount = doc->blockCount();
+        if (auto documentLayout = qobject_cast<TextEditor::TextDocumentLayout *>(
+                doc->documentLayout())) {
+            // marks being added, removed, updated or moved request an update
+            // of the extra area
+            connect(documentLayout,
+                    &TextEditor::TextDocumentLayout::updateExtraArea,
+                    this,
+                    &MinimapStyleObject::scheduleMarkerSync);
+            connect(documentLayout,
+                    &TextEditor::TextDocumentLayout::foldChanged,
+                    this,
+                    &MinimapStyleObject::foldChanged);
+        }
+        scheduleMarkerSync();
+        connect(doc->documentLayout(),
+                &QAbstractTextDocumentLayout::documentSizeChanged,
+                this,
+                &MinimapStyleObject::deferedUpdate);
+        connect(doc->documentLayout(),
+                &QAbstractTextDocumentLayout::update,
+                this,
+                &MinimapStyleObject::deferedUpdate);
     }
 
+    void disconnectDocument()
+    {
+        QTextDocument *doc = m_editor->document();
+        disconnect(doc,
+                   &QTextDocument::contentsChange,
+                   this,
+                   &MinimapStyleObject::documentContentsChange);
+        if (auto documentLayout = qobject_cast<TextEditor::TextDocumentLayout *>(
+                doc->documentLayout())) {
+            disconnect(documentLayout,
+                       &TextEditor::TextDocumentLayout::updateExtraArea,
+                       this,
+                       &MinimapStyleObject::scheduleMarkerSync);
+            disconnect(documentLayout,
+                       &TextEditor::TextDocumentLayout::foldChanged,
+                       this,
+                       &MinimapStyleObject::foldChanged);
+        }
+        disconnect(doc->documentLayout(),
+                   &QAbstractTextDocumentLayout::documentSizeChanged,
+                   this,
+                   &MinimapStyleObject::deferedUpdate);
+        disconnect(doc->documentLayout(),
+                   &QAbstractTextDocumentLayout::update,
+                   this,
+                   &MinimapStyleObject::deferedUpdate);
+    }
+
+    //! Merges the mark notifications of an event loop iteration into a
+    //! single sync.
+    void scheduleMarkerSync()
+    {
+        if (!m_markersPending) {
+            m_markersPending = true;
+            QMetaObject::invokeMethod(this,
+                                      &MinimapStyleObject::syncMarkers,
+                                      Qt::QueuedConnection);
+        }
+    }
+
+    //! Brings the marker layer up to date with the marks of the document as
+    //! one batch of changes.
+    void syncMarkers()
+    {
+        m_markersPending = false;
+        if (m_dormant) {
+            return;
+        }
+        QList<MinimapMarkerChange> changes;
+        QSet<quintptr> seen;
+        const TextEditor::TextMarks marks = m_editor->textDocument()->marks();
+        for (const TextEditor::TextMark *mark : marks) {
+            const std::optional<Utils::Theme::Color> color = mark->color();
+            if (!color || !mark->isVisible()) {
+                continue;
+            }
+            const MinimapMarker marker{reinterpret_cast<quintptr>(mark),
+                                       m_theme->color(*color).rgb(),
+                                       static_cast<int>(mark->priority())};
+            changes.append(MinimapMarkerChange{MinimapMarkerChange::Update,
+                                               mark->lineNumber() - 1,
+                                               marker});
+            seen.insert(marker.key);
+        }
+        const QHash<quintptr, int> &blocks = m_markers.blocks();
+        for (auto it = blocks.cbegin(); it != blocks.cend(); ++it) {
+            if (!seen.contains(it.key())) {
+                changes.append(MinimapMarkerChange{MinimapMarkerChange::Remove,
+                                                   it.value(),
+                                                   MinimapMarker{it.key(), 0, 0}});
+            }
+        }
+        if (m_markers.apply(changes)) {
+            m_editor->verticalScrollBar()->update();
+        }
+    }
+
+    void scrollbarValueChanged()
+    {
+        if (m_recorder) {
+            m_recorder->scroll(m_editor->verticalScrollBar()->value());
+        }
+        if (!m_dormant) {
+            updateSubControlRects();
+        }
+    }
+
+    //! Returns the line count used to compare against the threshold.
+    virtual int lineCountFor(int blockCount) const = 0;
+
+    //! Returns true if the first frame at the current size is expected to
+    //! use structural rows, before any frame decided it.
+    virtual bool expectsStructuralRows() const { return false; }
+
     virtual void update() = 0;
 
+    virtual bool renderMinimap(const QScrollBar *scrollbar) = 0;
+
     virtual void updateSubControlRects() = 0;
 
 protected:
+    void invalidateFrame() { m_frameDirty = true; }
+
+    //! Repaints what changed after the slider moved away from @a oldSlider:
+    //! the whole minimap if the frame is stale, the two slider rectangles
+    //! otherwise.
+    void repaintSlider(const QRect &oldSlider)
+    {
+        QScrollBar *scrollbar = m_editor->verticalScrollBar();
+        if (m_frameDirty) {
+            scrollbar->update();
+        } else if (oldSlider != m_slider) {
+            scrollbar->update(QRegion(oldSlider).united(m_slider));
+        }
+    }
+
+    //! Reallocates the minimap image only if its size changed. The image is
+    //! kept while a resize is in progress, it serves as the placeholder.
+    //! @a size is in logical pixels, the image is rendered at device
+    //! resolution unless imageScale() falls back to the logical one.
+    void resizeImage(const QSize &size)
+    {
+        if (isPlaceholder()) {
+            return;
+        }
+        const int scale = imageScale(size);
+        if (m_image.size() != size * scale || m_imageScale != scale) {
+            m_image = QImage(size * scale, QImage::Format_RGB32);
+            m_image.setDevicePixelRatio(scale);
+            m_imageScale = scale;
+        }
+    }
+
+    //! Returns the number of device pixels per logical pixel to render with.
+    //! Fractional ratios render at the next integer scale, which Qt scales
+    //! down when drawing, so there is never less than one image pixel per
+    //! device pixel. The governor drops to logical resolution first when
+    //! frames get too slow, and images that would get too large never use
+    //! the device one.
+    int imageScale(const QSize &size) const
+    {
+        const int scale = qMax(1, qCeil(m_editor->verticalScrollBar()->devicePixelRatioF()));
+        if (scale == 1 || m_governor.detail() != EMinimapDetail::eFull) {
+            return 1;
+        }
+        const qint64 pixels = qint64(size.width()) * size.height() * scale * scale;
+        return pixels <= maxDeviceImagePixels ? scale : 1;
+    }
+
+    //! Asks for a new layout of the scrollbar only if the width it reserves
+    //! for the minimap changed.
+    void updateGeometry()
+    {
+        const int w = minimapVisible() ? width() : 0;
+        if (m_geometryWidth != w) {
+            m_geometryWidth = w;
+            m_editor->verticalScrollBar()->updateGeometry();
+        }
+    }
+
+    //! Rows of the details the governor is not using right now.
+    void dropParkedRows()
+    {
+        for (MinimapRowCache &rows : m_parkedRows) {
+            rows = MinimapRowCache();
+        }
+    }
+
+    //! The active row cache followed by the parked ones.
+    std::array<MinimapRowCache *, parkedDetails + 1> rowCaches()
+    {
+        std::array<MinimapRowCache *, parkedDetails + 1> caches;
+        caches[0] = &m_rows;
+        for (int i = 0; i < parkedDetails; ++i) {
+            caches[i + 1] = &m_parkedRows[i];
+        }
+        return caches;
+    }
+
+    //! Makes sure the row cache matches the document, the minimap width, the
+    //! detail chosen by the governor and whether @a structural rows are used.
+    void ensureRowCache(int w, bool structural)
+    {
+        // rows of the blocks edited since the last update are not current
+        flushDirtyRows();
+        const int tab = m_editor->textDocument()->tabSettings().m_tabSize;
+        const int blockCount = m_editor->document()->blockCount();
+        // rows do not depend on the resolution they are shown at
+        const EMinimapDetail detail = m_governor.detail() == EMinimapDetail::eLogical
+                                          ? EMinimapDetail::eFull
+                                          : m_governor.detail();
+        m_highlighted = m_editor->textDocument()->syntaxHighlighter() != nullptr;
+        const int columns = MinimapSettings::compressLongLines() ? w * maxCompression : w;
+        bool remapped(false);
+        if (m_mirror.lineCount() != blockCount || m_mirror.maxColumns() != columns
+            || m_mirror.highlighted() != m_highlighted) {
+            m_mirror.reset(m_editor->document(), m_palette, columns, m_highlighted);
+            m_gutterStale = true;
+            remapped = true;
+        }
+        const int compression = rowCompression(w);
+        if (remapped || m_rowTab != tab || m_rowCompression != compression) {
+            // hits are kept in row columns
+            m_search.rescan(m_mirror.current(), tab, compression);
+        }
+        if (m_rowTab != tab || m_rowStructural != structural || m_rowCompression != compression) {
+            // the rows kept for the other details were rasterized the old way
+            dropParkedRows();
+        }
+        if (m_rowDetail != detail) {
+            // every detail keeps its own rows, the governor going back and
+            // forth between two of them does not rasterize the document again
+            m_parkedRows[static_cast<int>(m_rowDetail)] = std::move(m_rows);
+            m_rows = std::exchange(m_parkedRows[static_cast<int>(detail)], MinimapRowCache());
+            m_rowDetail = detail;
+            // edits made while the rows were parked did not reach them
+            m_rows.markStale();
+        }
+        if (remapped) {
+            // the highlighter may have come or gone
+            m_rows.markStale();
+        }
+        if (m_rows.width() != w || m_rows.rowCount() != blockCount || m_rowTab != tab
+            || m_rowStructural != structural || m_rowCompression != compression) {
+            m_rows.reset(blockCount, w);
+            if (detail == EMinimapDetail::eFull) {
+                // only full detail rows refer to the disk cache entry
+                m_diskRows.reset();
+            }
+            m_rowTab = tab;
+            m_rowStructural = structural;
+            m_rowCompression = compression;
+            if (!m_diskCacheChecked && detail == EMinimapDetail::eFull && !structural
+                && compression == 1) {
+                m_diskCacheChecked = true;
+                m_diskRows = MinimapDiskCache::load(m_editor->textDocument()->filePath(),
+                                                    diskCacheKey(),
+                                                    m_rows);
+            }
+        }
+    }
+
+    //! Returns the number of characters averaged into one pixel of a row:
+    //! the smallest power of two fitting the widest mirrored line into @a w,
+    //! if long lines are compressed. Tabs are counted as one character.
+    int rowCompression(int w) const
+    {
+        if (!MinimapSettings::compressLongLines() || w <= 0) {
+            return 1;
+        }
+        const qsizetype widest = m_mirror.widestLine();
+        int compression(1);
+        while (compression < maxCompression && widest > qsizetype(w) * compression) {
+            compression *= 2;
+        }
+        return compression;
+    }
+
+    //! Returns a key covering everything but the text the rows depend on.
+    uint diskCacheKey() const
+    {
+        const TextEditor::FontSettings &settings = m_editor->textDocument()->fontSettings();
+        return static_cast<uint>(qHashMulti(0,
+                                            m_palette.background.rgba(),
+                                            m_palette.foreground.rgba(),
+                                            m_palette.punctuation.rgba(),
+                                            m_palette.comment.rgba(),
+                                            settings.colorSchemeFileName().toString(),
+                                            m_theme ? m_theme->id() : QString(),
+                                            m_rows.width(),
+                                            m_rowTab));
+    }
+
+    void editorAboutToClose(Core::IEditor *editor)
+    {
+        if (editor->widget() == m_editor) {
+            storeToDiskCache();
+        }
+    }
+
+    void storeToDiskCache()
+    {
+        const Utils::FilePath filePath = m_editor->textDocument()->filePath();
+        QTextDocument *doc = m_editor->document();
+        if (!m_initialized || MinimapSettings::diskCacheSize() <= 0 || filePath.isEmpty()
+            || m_rowDetail != EMinimapDetail::eFull || m_rowStructural || m_rowCompression != 1
+            || m_rows.width() <= 0
+            || m_rows.rowCount() != doc->blockCount() || m_mirror.lineCount() != doc->blockCount()) {
+            return;
+        }
+        // only rows that are already correct are kept, closing must not wait
+        // for the rest to be rasterized
+        const uint key = diskCacheKey();
+        QList<uint> textHashes;
+        QList<bool> kept;
+        textHashes.reserve(doc->blockCount());
+        kept.reserve(doc->blockCount());
+        size_t contentHash(0);
+        bool any(false);
+        for (QTextBlock b = doc->begin(); b.isValid(); b = b.next()) {
+            const int n = b.blockNumber();
+            const uint textHash = seedHash(n);
+            const bool keep = m_rows.isValid(n, blockSignature(b, false))
+                              || m_rows.isSeeded(n, textHash);
+            textHashes.append(textHash);
+            kept.append(keep);
+            contentHash = qHashMulti(contentHash, textHash, keep);
+            any = any || keep;
+        }
+        if (!any || MinimapDiskCache::isStored(filePath, key, m_rows, static_cast<uint>(contentHash))) {
+            return;
+        }
+        // seeded rows that were never shown still have their pixels in the
+        // entry about to be replaced
+        for (int n = 0; n < kept.size(); ++n) {
+            if (kept.at(n) && !loadSeed(n)) {
+                kept[n] = false;
+            }
+        }
+        m_diskRows.reset();
+        MinimapDiskCache::store(filePath,
+                                key,
+                                m_rows,
+                                textHashes,
+                                kept,
+                                static_cast<uint>(contentHash));
+    }
+
+    //! What the row of a block depends on, worked out once per block.
+    struct RowState
+    {
+        bool pending;     //!< the highlighter did not reach the block yet
+        bool provisional; //!< the row does not depend on the formats
+        uint signature;   //!< blockSignature() of the row
+    };
+
+    //! Returns the rasterized row of @a b, rendering it only if the block
+    //! changed since it was last cached. @a extent receives the number of
+    //! pixels covered by the text of the block.
+    const QRgb *cachedRow(const QTextBlock &b, int &extent)
+    {
+        const int n = b.blockNumber();
+        QRgb *row = m_rows.row(n);
+        if (m_rows.isCurrent(n)) {
+            extent = m_rows.extent(n);
+            return row;
+        }
+        const RowState state = rowState(b);
+        if (needsRasterization(b, n, state)) {
+            m_arena.reset();
+            const MinimapLine &line = mirroredLine(b, n, state);
+            m_rows.setValid(n,
+                            state.signature,
+                            state.provisional,
+                            rasterizeLine(line, row, m_rows.width(), m_rowTab, m_palette));
+        }
+        extent = m_rows.extent(n);
+        return row;
+    }
+
+    //! Brings the rows of @a count blocks starting at @a first up to date.
+    //!
+    //! The blocks to render are captured into snapshots on the GUI thread and
+    //! rasterized in parallel bands, each writing a disjoint set of rows.
+    //! Blending rows into the minimap happens afterwards in document order,
+    //! so the result does not depend on how the rows were split into bands.
+    void prepareRows(QTextBlock first, int count)
+    {
+        m_arena.reset();
+        m_jobs.clear();
+        {
+            MinimapTraceScope scope("formatMerge");
+            for (QTextBlock b = first; b.isValid() && count > 0; b = b.next(), --count) {
+                const int n = b.blockNumber();
+                // only blocks changed since they were rasterized are
+                // looked at, their formats are not hashed again per frame
+                if (m_rows.isCurrent(n)) {
+                    continue;
+                }
+                const RowState state = rowState(b);
+                if (needsRasterization(b, n, state)) {
+                    m_jobs.append(RowJob{n, state.signature, 0});
+                    mirroredLine(b, n, state);
+                }
+            }
+            scope.setBlocks(m_jobs.size());
+        }
+        if (m_jobs.isEmpty()) {
+            return;
+        }
+
+        const int jobCount = static_cast<int>(m_jobs.size());
+        const int w = m_rows.width();
+        MinimapTraceScope scope("rasterization");
+        scope.setBlocks(jobCount);
+        scope.setPixels(qint64(jobCount) * w);
+        RowJob *jobs = m_jobs.data();
+        const MinimapLine *lines = m_arena.lines();
+        const int bandCount = qBound(1, jobCount / minimumBandSize, QThread::idealThreadCount());
+        const int bandSize = (jobCount + bandCount - 1) / bandCount;
+        m_bands.clear();
+        for (int i = 0; i < jobCount; i += bandSize) {
+            m_bands.append(i);
+        }
+        auto rasterizeBand = [&](int begin) {
+            const int end = qMin(begin + bandSize, jobCount);
+            for (int i = begin; i < end; ++i) {
+                jobs[i].extent = rasterizeLine(lines[i], m_rows.row(jobs[i].row), w, m_rowTab, m_palette);
+            }
+        };
+        if (m_bands.size() == 1) {
+            rasterizeBand(0);
+        } else {
+            QtConcurrent::blockingMap(m_bands, rasterizeBand);
+        }
+
+        for (int i = 0; i < jobCount; ++i) {
+            m_rows.setValid(jobs[i].row, jobs[i].signature, lines[i].provisional, jobs[i].extent);
+        }
+    }
+
+    //! Recaptures the mirrored line of @a b if the formats changed without a
+    //! contentsChange notification.
+    void syncMirrorLine(const QTextBlock &b, int n, const RowState &state)
+    {
+        // the mirror keeps the formats unless they are pending, at full
+        // detail it shares the signature of the row
+        const uint signature = state.provisional == state.pending
+                                   ? state.signature
+                                   : blockSignature(b, state.pending);
+        if (m_mirror.signature(n) != signature) {
+            m_mirror.update(n, b, state.pending, signature);
+        }
+    }
+
+    //! Resolves the mirrored line of @a b into the next line of the arena.
+    const MinimapLine &mirroredLine(const QTextBlock &b, int n, const RowState &state)
+    {
+        syncMirrorLine(b, n, state);
+        MinimapLine &line = m_arena.nextLine();
+        MinimapDocumentMirror::resolve(m_mirror.current(), n, line);
+        line.detail = m_rowDetail;
+        line.structural = m_rowStructural;
+        line.compression = m_rowCompression;
+        return line;
+    }
+
+    //! Returns the RowState of @a b. Its row does not depend on the formats
+    //! if the highlighter did not reach it yet or the governor reduced the
+    //! detail.
+    RowState rowState(const QTextBlock &b) const
+    {
+        const bool pending = m_highlighted && isHighlightPending(b);
+        const bool provisional = pending || m_rowDetail != EMinimapDetail::eFull;
+        return RowState{pending, provisional, blockSignature(b, provisional)};
+    }
+
+    bool needsRasterization(const QTextBlock &b, int n, const RowState &state)
+    {
+        if (m_rows.isValid(n, state.signature)) {
+            m_rows.setCurrent(n);
+            return false;
+        }
+        if (!state.provisional || !m_rows.isSeeded(n)) {
+            return true;
+        }
+        // a row restored from the disk cache beats the provisional coloring
+        syncMirrorLine(b, n, state);
+        if (!m_rows.isSeeded(n, seedHash(n)) || !loadSeed(n)) {
+            return true;
+        }
+        m_rows.setCurrent(n);
+        return false;
+    }
+
+    //! Reads the pixels of the seeded row @a n from the disk cache entry if
+    //! that did not happen yet. Returns false if they are not available.
+    bool loadSeed(int n)
+    {
+        const int source = m_rows.seedSource(n);
+        if (source < 0) {
+            return true;
+        }
+        if (!m_diskRows || !m_diskRows->read(source, m_rows.row(n))) {
+            return false;
+        }
+        m_rows.setSeedLoaded(n);
+        return true;
+    }
+
+    //! Returns the hash rows restored from the disk cache are checked with.
+    //! It is taken from the mirrored text, which does not allocate, and only
+    //! covers the first width() characters, those are all a row can show.
+    uint seedHash(int n) const
+    {
+        const QString &text = m_mirror.line(n).text;
+        return static_cast<uint>(
+            qHash(QStringView(text).first(qMin(text.size(), qsizetype(m_rows.width())))));
+    }
+
     Utils::Theme *m_theme;
     TextEditor::TextEditorWidget *m_editor;
     qreal m_factor;
@@ -384,21 +1756,80 @@ protected:
     QColor m_backgroundColor, m_foregroundColor, m_overlayColor;
     bool m_update;
     bool m_isDragging;
+    bool m_initialized;
+    bool m_dormant;
     QPoint m_lastMousePos;
+    QPoint m_lensPos;
+    QTimer m_lensTimer;
+    QTimer m_occurrenceTimer;
+    QPointer<MinimapLens> m_lens;
     QImage m_image;
+    MinimapRowCache m_rows;
+    std::array<MinimapRowCache, parkedDetails> m_parkedRows;
+    MinimapDocumentMirror m_mirror;
+    MinimapLayout m_layout;
+    MinimapSearchLayer m_search;
+    QString m_findTerm;
+    Utils::FindFlags m_findFlags;
+    QColor m_searchColor, m_occurrenceColor;
+    std::unique_ptr<MinimapTraceRecorder> m_recorder;
+    MinimapPalette m_palette;
+    int m_rowTab;
+    bool m_highlighted;
+    bool m_diskCacheChecked;
+    std::unique_ptr<MinimapDiskCacheRows> m_diskRows;
+    MinimapGovernor m_governor;
+    EMinimapDetail m_rowDetail;
+    bool m_rowStructural;
+    int m_rowCompression;
+    QTimer m_updateTimer;
+    QElapsedTimer m_pendingSince;
+    int m_dirtyFirst;
+    int m_dirtyLast;
+    QTimer m_resizeTimer;
+    bool m_resizing;
+    int m_renderedHeight;
+    int m_geometryWidth;
+    int m_imageScale;
+    QImage m_previousImage;
+    QPixmap m_pixmap;
+    bool m_frameDirty;
+    size_t m_frameKey;
+    MinimapMarkerLayer m_markers;
+    int m_blockCount;
+    bool m_markersPending;
+    MinimapGutterLayer m_gutter;
+    size_t m_gutterKey;
+    bool m_gutterStale;
+    int m_gutterFirst;
+    int m_gutterLast;
+    bool m_prerendered;
+    int m_prerenderNext;
+
+    // scratch buffers reused by every frame
+    struct RowJob
+    {
+        int row;
+        uint signature;
+        int extent;
+    };
+    MinimapArena m_arena;
+    QList<RowJob> m_jobs;
+    QList<int> m_bands;
 };
 
 class MinimapStyleObjectScalingStrategy : public MinimapStyleObject
 {
 public:
-    MinimapStyleObjectScalingStrategy(TextEditor::BaseTextEditor *editor)
+    MinimapStyleObjectScalingStrategy(TextEditor::BaseTextEditor *editor, bool structural)
         : MinimapStyleObject(editor)
+        , m_structural(structural)
     {
     }
 
     ~MinimapStyleObjectScalingStrategy() { }
 
-    bool drawMinimap(const QScrollBar* /*scrollbar*/) override
+    bool renderMinimap(const QScrollBar* /*scrollbar*/) override
     {
         if (TextEditor::TextEditorSettings::displaySettings().m_textWrapping) {
             return false;
@@ -407,139 +1838,119 @@ public:
         if (m_factor < 1.0) {
             h = lineCount();
         }
-        qreal step = 1 / m_factor;
         QColor baseBg = background();
-        QColor baseFg = foreground();
         int w = width() - Constants::MINIMAP_EXTRA_AREA_WIDTH;
         if (w <= 0 || h <= 0) {
             return false;
         }
 
         m_image.fill(baseBg);
+        // characters are mostly noise once many lines share a pixel row
+        ensureRowCache(w, structuralAt(m_factor));
         QTextDocument *doc = editor()->document();
-        TextEditor::TextDocumentLayout *documentLayout = qobject_cast<TextEditor::TextDocumentLayout *>(
-            doc->documentLayout());
-        int tab = editor()->textDocument()->tabSettings().m_tabSize;
+        prepareRows(doc->begin(), doc->blockCount());
+
+        Frame frame;
+        frame.h = h;
+        frame.scale = m_imageScale;
+        frame.ppl = MinimapSettings::pixelsPerLine() * frame.scale;
+        frame.step = 1 / m_factor;
+
+        // pick the render loop specialized for this frame once, instead of
+        // branching on frame invariant state for every line
+        using RenderRows = void (MinimapStyleObjectScalingStrategy::*)(const Frame &);
+        static constexpr RenderRows renderers[] = {
+            &MinimapStyleObjectScalingStrategy::renderRows<false>,
+            &MinimapStyleObjectScalingStrategy::renderRows<true>,
+        };
+        const int index = m_factor < 1.0 ? 1 : 0;
+        m_accumulator.reset(m_rows.width(), MinimapSettings::downsampling(), baseBg.rgb());
+        m_layout.reset(doc->blockCount(), qMax(1, frame.ppl - 1), frame.scale);
+        MinimapTraceScope scope("rowDuplication");
+        scope.setBlocks(doc->blockCount());
+        scope.setPixels(qint64(m_image.width()) * m_image.height());
+        (this->*renderers[index])(frame);
+
+        return true;
+    }
+private:
+    struct Frame
+    {
+        int h;
+        int scale;
+        int ppl; // in device pixels
+        qreal step;
+    };
+
+    bool m_structural;
+    MinimapRowAccumulator m_accumulator;
+
+    template<bool Blending>
+    void renderRows(const Frame &frame)
+    {
+        QTextDocument *doc = editor()->document();
+        int *tops = m_layout.tops.data();
         int y(0);
         int i(0);
         qreal r(0.0);
-        bool codeFoldingVisible = editor()->codeFoldingVisible();
-        bool revisionsVisible = editor()->revisionsVisible();
-        bool folded(false);
-        int revision(0);
-        for (QTextBlock b = doc->begin(); b.isValid() && y < h; b = b.next()) {
-            bool updateY(true);
-            if (b.isVisible()) {
-                if (qRound(r) != i++) {
-                    updateY = false;
-                } else {
-                    r += step;
-                }
-            } else {
+        for (QTextBlock b = doc->begin(); b.isValid(); b = b.next()) {
+            if (!b.isVisible()) {
                 continue;
             }
-            if (codeFoldingVisible && !folded) {
-                folded = TextEditor::TextBlockUserData::isFolded(b);
-            }
-            if (revisionsVisible) {
-                if (b.revision() != documentLayout->lastSaveRevision) {
-                    if (revision < 1 && b.revision() < 0) {
-                        revision = 1;
-                    } else if (revision < 2) {
-                        revision = 2;
+            int extent(0);
+            if constexpr (Blending) {
+                // a line reaching the next scaled position starts a pixel
+                // row, the lines until then are merged into it
+                if (qRound(r) == i++) {
+                    r += frame.step;
+                    if (m_accumulator.lineCount() > 0) {
+                        const QRgb *merged = m_accumulator.resolve(extent);
+                        writeRow(y++, merged, extent, frame);
                     }
                 }
-            }
-            int x(0);
-            bool cont(true);
-            QRgb *scanLine = reinterpret_cast<QRgb *>(m_image.scanLine(y * MinimapSettings::instance()->pixelsPerLine()));
-            QVector<QTextLayout::FormatRange> formats = b.layout()->formats();
-            std::sort(formats.begin(),
-                      formats.end(),
-                      [](const QTextLayout::FormatRange &r1, const QTextLayout::FormatRange &r2) {
-                          if (r1.start < r2.start) {
-                              return true;
-                          } else if (r1.start > r2.start) {
-                              return false;
-                          }
-                          return r1.length < r2.length;
-                      });
-            QColor bBg = baseBg;
-            QColor bFg = baseFg;
-            merge(bBg, bFg, b.charFormat());
-            auto it2 = formats.begin();
-            for (QTextBlock::iterator it = b.begin(); !(it.atEnd()); ++it) {
-                QTextFragment f = it.fragment();
-                if (f.isValid()) {
-                    QColor fBg = bBg;
-                    QColor fFg = bFg;
-                    merge(fBg, fFg, f.charFormat());
-                    for (const QChar &c : f.text()) {
-                        QColor bg = fBg;
-                        QColor fg = fFg;
-                        it2 = std::find_if(it2, formats.end(), [&x](const QTextLayout::FormatRange &r) {
-                            return x >= r.start && x < r.start + r.length;
-                        });
-                        if (it2 != formats.end()) {
-                            merge(bg, fg, it2->format);
-                        }
-                        cont = updatePixel(&scanLine[Constants::MINIMAP_EXTRA_AREA_WIDTH],
-                                           !updateY,
-                                           c,
-                                           x,
-                                           w,
-                                           tab,
-                                           bg,
-                                           fg);
-                        if (!cont) {
-                            break;
-                        }
-                    }
-                    if (!cont) {
-                        break;
-                    }
-                } else {
-                    cont = false;
+                if (y >= frame.h) {
                     break;
                 }
-            }
-
-
-            int originalY = y;
-            if (updateY) {
-                ++y;
-                if (revision == 1) {
-                    scanLine[1] = green;
-                    scanLine[2] = green;
-                } else if (revision == 2) {
-                    scanLine[1] = red;
-                    scanLine[2] = red;
-                }
-                if (folded) {
-                    scanLine[4] = black;
-                    scanLine[5] = black;
+                tops[b.blockNumber()] = y * frame.ppl;
+                const QRgb *row = cachedRow(b, extent);
+                m_accumulator.add(row, extent);
+            } else {
+                if (y >= frame.h) {
+                    break;
                 }
-                folded = false;
-                revision = 0;
+                tops[b.blockNumber()] = y * frame.ppl;
+                const QRgb *row = cachedRow(b, extent);
+                writeRow(y++, row, extent, frame);
             }
-
-            // repeat the line on the next lines to give every line a height of
-            // (pixelsPerLine - 1), resulting in a 1px gap between lines
-            for (int duplicationLineY = 1;
-                 duplicationLineY < MinimapSettings::instance()->pixelsPerLine() - 1;
-                 ++duplicationLineY) {
-                QRgb *targetScanLine = reinterpret_cast<QRgb *>(m_image.scanLine(
-                    originalY * MinimapSettings::instance()->pixelsPerLine() + duplicationLineY));
-
-                memcpy(targetScanLine, scanLine, m_image.bytesPerLine());
+        }
+        if constexpr (Blending) {
+            if (m_accumulator.lineCount() > 0 && y < frame.h) {
+                int extent(0);
+                const QRgb *merged = m_accumulator.resolve(extent);
+                writeRow(y, merged, extent, frame);
             }
         }
+    }
 
-        return true;
+    //! Draws @a row as pixel row @a y of the minimap.
+    void writeRow(int y, const QRgb *row, int extent, const Frame &frame)
+    {
+        QRgb *scanLine = reinterpret_cast<QRgb *>(m_image.scanLine(y * frame.ppl));
+        copyRow(&scanLine[Constants::MINIMAP_EXTRA_AREA_WIDTH * frame.scale], row, extent, frame.scale);
+
+        // repeat the line on the next lines to give every line a height of
+        // (pixelsPerLine - 1), resulting in a 1px gap between lines
+        for (int duplicationLineY = 1; duplicationLineY < frame.ppl - 1; ++duplicationLineY) {
+            QRgb *targetScanLine = reinterpret_cast<QRgb *>(
+                m_image.scanLine(y * frame.ppl + duplicationLineY));
+
+            memcpy(targetScanLine, scanLine, m_image.bytesPerLine());
+        }
     }
-private:
+
     void centerViewportOnMousePosition(const QPoint &mousePos) override
     {
+        MinimapTraceScope scope("centerViewportOnMousePosition");
         QScrollBar *scrollbar = m_editor->verticalScrollBar();
 
         int mouseY = mousePos.y();
@@ -594,12 +2005,30 @@ private:
         }
     }
 
+    int lineCountFor(int blockCount) const override
+    {
+        return qMax(blockCount, 1) * MinimapSettings::instance()->pixelsPerLine();
+    }
+
+    bool expectsStructuralRows() const override
+    {
+        // the scrollbar is as high as the editor
+        const int lines = lineCountFor(m_editor->document()->blockCount());
+        const int h = m_editor->height();
+        return structuralAt(lines <= h ? 1.0 : h / static_cast<qreal>(lines));
+    }
+
+    //! Returns true if the rows of a frame scaled by @a factor are structural.
+    bool structuralAt(qreal factor) const
+    {
+        return m_structural && factor * 100 < MinimapSettings::structuralScale();
+    }
+
     void update() override
     {
         QScrollBar *scrollbar = m_editor->verticalScrollBar();
 
-        m_lineCount = qMax(m_editor->document()->blockCount(), 1)
-                      * MinimapSettings::instance()->pixelsPerLine();
+        m_lineCount = lineCountFor(m_editor->document()->blockCount());
 
         int w = scrollbar->width();
         int h = scrollbar->height();
@@ -607,14 +2036,16 @@ private:
         int width = this->width();
         m_groove = QRect(width, 0, w - width, qMin(m_lineCount, h));
         updateSubControlRects();
-        scrollbar->updateGeometry();
-        m_image = QImage(width, h * MinimapSettings::instance()->pixelsPerLine(), QImage::Format_RGB32);
+        updateGeometry();
+        resizeImage(QSize(width, h * MinimapSettings::instance()->pixelsPerLine()));
         m_update = false;
     }
 
     void updateSubControlRects() override
     {
+        MinimapTraceScope scope("updateSubControlRects");
         QScrollBar *scrollbar = m_editor->verticalScrollBar();
+        const QRect oldSlider = m_slider;
 
         if (m_lineCount <= 0) {
             m_addPage = QRect();
@@ -668,7 +2099,7 @@ private:
         m_subPage = (realValue > 0) ? QRect(0, 0, w, realValue) : QRect();
         m_slider = QRect(0, realValue, w, viewPortLineCount);
 
-        scrollbar->update();
+        repaintSlider(oldSlider);
     }
 };
 
@@ -682,22 +2113,16 @@ public:
 
     ~MinimapStyleObjectScrollingStrategy() { }
 
-    bool drawMinimap(const QScrollBar *scrollbar) override
+    bool renderMinimap(const QScrollBar *scrollbar) override
     {
         // 1. Basic Geometry Setup
         int h = editor()->size().height();
         int ppl = MinimapSettings::instance()->pixelsPerLine();
-        QColor baseBg = background();
-        QColor baseFg = foreground();
         int w = width() - Constants::MINIMAP_EXTRA_AREA_WIDTH;
         if (w <= 0 || h <= 0) {
             return false;
         }
 
-        int tab = editor()->textDocument()->tabSettings().m_tabSize;
-        bool codeFoldingVisible = editor()->codeFoldingVisible();
-        bool revisionsVisible = editor()->revisionsVisible();
-
         // 1. GET THE ACTUAL VISIBLE HEIGHT (Units = lines)
         // Qt's documentSize().height() returns the number of visible lines
         // when using PlainTextEdit layouts.
@@ -730,99 +2155,67 @@ public:
 
         // 4. RENDERING
         m_image.fill(background());
+        ensureRowCache(w, false);
+        prepareRows(b, h / ppl + 2);
 
         int y = qRound(-subLineOffset);
 
         // --- RENDERING LOOP ---
-        TextEditor::TextDocumentLayout *documentLayout =
-            qobject_cast<TextEditor::TextDocumentLayout *>(editor()->document()->documentLayout());
+        Frame frame;
+        frame.scale = m_imageScale;
+        frame.h = h * frame.scale;
+        frame.ppl = ppl * frame.scale;
+        frame.y = y * frame.scale;
+
+        m_layout.reset(editor()->document()->blockCount(), qMax(1, frame.ppl - 1), frame.scale);
+        MinimapTraceScope scope("rowDuplication");
+        scope.setBlocks(h / ppl + 2);
+        scope.setPixels(qint64(m_image.width()) * m_image.height());
+        renderRows(b, frame);
 
-        while (b.isValid() && y < h) {
+        return true;
+    }
+private:
+    struct Frame
+    {
+        // in device pixels
+        int h;
+        int scale;
+        int ppl;
+        int y;
+    };
+
+    void renderRows(QTextBlock b, const Frame &frame)
+    {
+        int *tops = m_layout.tops.data();
+        int y = frame.y;
+        while (b.isValid() && y < frame.h) {
             if (!b.isVisible()) {
                 b = b.next();
                 continue;
             }
 
-            bool folded = codeFoldingVisible && TextEditor::TextBlockUserData::isFolded(b);
-            int revision = 0;
-            if (revisionsVisible && b.revision() != documentLayout->lastSaveRevision) {
-                revision = (b.revision() < 0) ? 1 : 2;
-            }
-
             // Render line pixels
-            QRgb *scanLine = reinterpret_cast<QRgb *>(m_image.scanLine(qMax(0, qMin(y, h - 1))));
-            int x = 0;
-            bool lineCont = true;
-
-            // Get highlighting formats
-            QVector<QTextLayout::FormatRange> formats = b.layout()->formats();
-            std::sort(formats.begin(), formats.end(), [](const QTextLayout::FormatRange &r1, const QTextLayout::FormatRange &r2) {
-                return r1.start < r2.start;
-            });
-
-            QColor bBg = baseBg;
-            QColor bFg = baseFg;
-            merge(bBg, bFg, b.charFormat());
-
-            auto itFormat = formats.begin();
-            for (QTextBlock::iterator it = b.begin(); !it.atEnd() && lineCont; ++it) {
-                QTextFragment f = it.fragment();
-                if (!f.isValid()) continue;
-
-                QColor fBg = bBg;
-                QColor fFg = bFg;
-                merge(fBg, fFg, f.charFormat());
-
-                QString text = f.text();
-                for (int i = 0; i < text.length(); ++i) {
-                    const QChar &c = text.at(i);
-                    QColor charBg = fBg;
-                    QColor charFg = fFg;
-
-                    // Apply syntax highlighting colors
-                    int fragPos = f.position() + i - b.position();
-                    while (itFormat != formats.end() && itFormat->start + itFormat->length <= fragPos) {
-                        ++itFormat;
-                    }
-                    if (itFormat != formats.end() && fragPos >= itFormat->start) {
-                        merge(charBg, charFg, itFormat->format);
-                    }
-
-                    lineCont = updatePixel(&scanLine[Constants::MINIMAP_EXTRA_AREA_WIDTH],
-                                           false, // blend
-                                           c, x, w, tab, charBg, charFg);
-                    if (!lineCont) break;
-                }
-            }
-
-            // Draw Revision and Folding markers
-            if (revision == 1) {
-                scanLine[1] = green;
-                scanLine[2] = green;
-            } else if (revision == 2) {
-                scanLine[1] = red;
-                scanLine[2] = red;
-            }
-            if (folded) {
-                scanLine[4] = black;
-                scanLine[5] = black;
-            }
+            QRgb *scanLine = reinterpret_cast<QRgb *>(m_image.scanLine(qMax(0, qMin(y, frame.h - 1))));
+            tops[b.blockNumber()] = y;
+            int extent(0);
+            const QRgb *row = cachedRow(b, extent);
+            copyRow(&scanLine[Constants::MINIMAP_EXTRA_AREA_WIDTH * frame.scale], row, extent, frame.scale);
 
             // Duplicate for line height
-            for (int dy = 1; dy < ppl - 1; ++dy) {
-                if (y + dy >= 0 && y + dy < h)
+            for (int dy = 1; dy < frame.ppl - 1; ++dy) {
+                if (y + dy >= 0 && y + dy < frame.h)
                     memcpy(m_image.scanLine(y + dy), scanLine, m_image.bytesPerLine());
             }
 
-            y += ppl;
+            y += frame.ppl;
             b = b.next();
         }
-
-        return true;
     }
-private:
+
     void centerViewportOnMousePosition(const QPoint &mousePos) override
     {
+        MinimapTraceScope scope("centerViewportOnMousePosition");
         QScrollBar *scrollbar = m_editor->verticalScrollBar();
 
         qreal documentHeight =
@@ -841,13 +2234,18 @@ private:
         scrollbar->setValue(iValue);
     }
 
+    int lineCountFor(int blockCount) const override
+    {
+        return qMax(blockCount, 1);
+    }
+
     void update() override
     {
         QScrollBar *scrollbar = m_editor->verticalScrollBar();
 
         // should be line count
         // multiplied by ppl results in the height of the image needed to render the whole doc
-        m_lineCount = qMax(m_editor->document()->blockCount(), 1);
+        m_lineCount = lineCountFor(m_editor->document()->blockCount());
         int docHeight = m_lineCount * MinimapSettings::instance()->pixelsPerLine();
 
         int w = scrollbar->width();
@@ -855,16 +2253,18 @@ private:
         int width = this->width();
         m_groove = QRect(width, 0, w - width, qMin(docHeight, h));
         updateSubControlRects();
-        scrollbar->updateGeometry();
+        updateGeometry();
 
-        m_image = QImage(width, editor()->size().height(), QImage::Format_RGB32);
+        resizeImage(QSize(width, editor()->size().height()));
 
         m_update = false;
     }
 
     void updateSubControlRects() override
     {
+        MinimapTraceScope scope("updateSubControlRects");
         QScrollBar *scrollbar = m_editor->verticalScrollBar();
+        const QRect oldSlider = m_slider;
 
         if (m_lineCount <= 0) {
             m_addPage = QRect();
@@ -897,6 +2297,11 @@ private:
         // Ensure we don't calculate beyond the scrollbar height
         int effectiveMinimapHeight = qMin(actualContentHeight, h);
 
+        // a document taller than the minimap pans along with the scrollbar
+        if (actualContentHeight > m_editor->height()) {
+            invalidateFrame();
+        }
+
         qreal realValue = 0;
         if (max > min && effectiveMinimapHeight > viewPortHeightInMinimap) {
             qreal scrollRatio = static_cast<qreal>(value - min) / (max - min);
@@ -918,7 +2323,7 @@ private:
         int addPageTop = qCeil(realValue + viewPortHeightInMinimap);
         m_addPage = (addPageTop < h) ? QRect(0, addPageTop, w, h - addPageTop) : QRect();
 
-        scrollbar->update();
+        repaintSlider(oldSlider);
     }
 };
 
@@ -934,8 +2339,7 @@ void MinimapStyle::drawComplexControl(ComplexControl control,
         QVariant v = widget->property(Constants::MINIMAP_STYLE_OBJECT_PROPERTY);
         if (v.isValid()) {
             MinimapStyleObject *o = static_cast<MinimapStyleObject *>(v.value<QObject *>());
-            int lineCount = o->lineCount();
-            if (lineCount > 0 && lineCount <= MinimapSettings::lineCountThreshold()) {
+            if (o->minimapVisible()) {
                 if (drawMinimap(option, painter, widget, o)) {
                     return;
                 }
@@ -954,8 +2358,7 @@ QStyle::SubControl MinimapStyle::hitTestComplexControl(ComplexControl control,
         QVariant v = widget->property(Constants::MINIMAP_STYLE_OBJECT_PROPERTY);
         if (v.isValid()) {
             MinimapStyleObject *o = static_cast<MinimapStyleObject *>(v.value<QObject *>());
-            int lineCount = o->lineCount();
-            if (lineCount > 0 && lineCount <= MinimapSettings::lineCountThreshold()) {
+            if (o->minimapVisible()) {
                 // If center-on-click is enabled, we handle mouse events differently
                 if (MinimapSettings::centerOnClick()) {
                     return SC_ScrollBarGroove;
@@ -991,8 +2394,7 @@ int MinimapStyle::pixelMetric(PixelMetric metric,
         QVariant v = widget->property(Constants::MINIMAP_STYLE_OBJECT_PROPERTY);
         if (v.isValid()) {
             MinimapStyleObject *o = static_cast<MinimapStyleObject *>(v.value<QObject *>());
-            int lineCount = o->lineCount();
-            if (lineCount > 0 && lineCount <= MinimapSettings::lineCountThreshold()) {
+            if (o->minimapVisible()) {
                 w += o->width();
             }
         }
@@ -1010,8 +2412,7 @@ QRect MinimapStyle::subControlRect(ComplexControl cc,
         QVariant v = widget->property(Constants::MINIMAP_STYLE_OBJECT_PROPERTY);
         if (v.isValid()) {
             MinimapStyleObject *o = static_cast<MinimapStyleObject *>(v.value<QObject *>());
-            int lineCount = o->lineCount();
-            if (lineCount > 0 && lineCount <= MinimapSettings::lineCountThreshold()) {
+            if (o->minimapVisible()) {
                 switch (sc) {
                 case QStyle::SC_ScrollBarGroove:
                     return o->groove();
@@ -1040,11 +2441,21 @@ bool MinimapStyle::drawMinimap(const QStyleOptionComplex *option,
         return false;
     }
 
+    QElapsedTimer timer;
+    timer.start();
+    MinimapTraceScope scope("drawMinimap");
+    scope.setBlocks(o->editor()->document()->blockCount());
     o->drawMinimap(scrollbar);
 
+    // slider moves only expose the old and new slider rectangles
+    const QRect exposed = exposedRect(painter, option->rect);
+    MinimapTraceScope blit("blit");
+    blit.setPixels(qint64(exposed.width()) * exposed.height());
     painter->save();
-    painter->fillRect(option->rect, o->background());
-    painter->drawImage(option->rect, o->minimapImage(), option->rect);
+    painter->setClipRect(exposed);
+    painter->fillRect(exposed, o->background());
+    painter->drawPixmap(exposed, o->minimapPixmap(), o->imageSourceRect(exposed));
+    o->drawLayers(painter, exposed);
     painter->setPen(Qt::NoPen);
     painter->setBrush(o->overlay());
     QRect rect = subControlRect(QStyle::CC_ScrollBar, option, QStyle::SC_ScrollBarSlider, widget)
@@ -1058,6 +2469,9 @@ bool MinimapStyle::drawMinimap(const QStyleOptionComplex *option,
     painter->drawLine(option->rect.topLeft(), option->rect.bottomLeft());
 
     painter->restore();
+    MinimapTraceReplay::addSample(o->editor(),
+                                  MinimapTraceReplay::Sample::Paint,
+                                  timer.nsecsElapsed());
     return true;
 }
 
@@ -1071,12 +2485,27 @@ void MinimapStyle::setSplitterColor(const QColor &splitterColor)
     m_splitterColor = splitterColor;
 }
 
+#ifdef WITH_TESTS
+bool MinimapStyle::renderFrame(const QScrollBar *scrollbar)
+{
+    QVariant v = scrollbar->property(Constants::MINIMAP_STYLE_OBJECT_PROPERTY);
+    if (!v.isValid()) {
+        return false;
+    }
+    MinimapStyleObject *o = static_cast<MinimapStyleObject *>(v.value<QObject *>());
+    return o->minimapVisible() && o->renderFrame();
+}
+#endif
+
 QObject *MinimapStyle::createMinimapStyleObject(TextEditor::BaseTextEditor *editor)
 {
     switch (MinimapSettings::instance()->style())
     {
     case Minimap::EMinimapStyle::eScaling:
-        return new MinimapStyleObjectScalingStrategy(editor);
+        return new MinimapStyleObjectScalingStrategy(editor, false);
+        break;
+    case Minimap::EMinimapStyle::eStructural:
+        return new MinimapStyleObjectScalingStrategy(editor, true);
         break;
     case Minimap::EMinimapStyle::eScrolling:
         return new MinimapStyleObjectScrollingStrategy(editor);
@@ -22,6 +22,8 @@
 
 #include <QProxyStyle>
 
+class QScrollBar;
+
 namespace TextEditor {
 class BaseTextEditor;
 }
@@ -58,6 +60,11 @@ public:
 
     static QObject *createMinimapStyleObject(TextEditor::BaseTextEditor *editor);
 
+#ifdef WITH_TESTS
+    //! Renders a frame of the minimap of @a scrollbar, if it shows one.
+    static bool renderFrame(const QScrollBar *scrollbar);
+#endif
+
     QColor splitterColor() const;
     void setSplitterColor(const QColor &newSplitterColor);
 
@@ -0,0 +1,456 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#include "minimaptrace.h"
+#include "minimapconstants.h"
+#include "minimapsettings.h"
+
+#include <coreplugin/editormanager/editormanager.h>
+#include <coreplugin/editormanager/ieditor.h>
+#include <coreplugin/icore.h>
+#include <coreplugin/idocument.h>
+#include <texteditor/textdocument.h>
+#include <texteditor/texteditor.h>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMouseEvent>
+#include <QMutex>
+#include <QScrollBar>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+
+namespace Minimap {
+namespace Internal {
+namespace {
+const quint32 traceMagic = 0x4d4d5452; // "MMTR"
+const quint32 traceVersion = 1;
+// time to let the last event settle before reporting
+const int replaySettleDelay = 1000; // ms
+
+// size of the buffered events that triggers writing them out
+const int eventFlushSize = 64 * 1024;
+
+struct EventLog
+{
+    QMutex mutex;
+    QFile file;
+    QByteArray buffer;
+    bool empty = true;
+};
+
+EventLog &eventLog()
+{
+    static EventLog log;
+    return log;
+}
+
+void closeEventLog(EventLog &log)
+{
+    if (log.file.isOpen()) {
+        log.buffer += "\n]\n";
+        log.file.write(log.buffer);
+        log.buffer.clear();
+        log.file.close();
+    }
+}
+
+qint64 percentile(const QList<qint64> &sorted, int p)
+{
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    const qsizetype index = (sorted.size() * p + 99) / 100 - 1;
+    return sorted.at(qBound(qsizetype(0), index, sorted.size() - 1));
+}
+} // namespace
+
+MinimapTraceReplay *MinimapTraceReplay::s_instance = nullptr;
+std::atomic_bool MinimapTraceEvents::s_enabled(false);
+
+std::unique_ptr<MinimapTraceRecorder> MinimapTraceRecorder::create(
+    TextEditor::TextEditorWidget *editor)
+{
+    const QString dir = qEnvironmentVariable(Constants::MINIMAP_TRACE_RECORD_ENV);
+    if (dir.isEmpty()) {
+        return nullptr;
+    }
+    const QString fileName = editor->textDocument()->filePath().fileName();
+    const QString path = QDir(dir).filePath(
+        QString("%1-%2.mmtrace").arg(fileName).arg(QDateTime::currentMSecsSinceEpoch()));
+
+    std::unique_ptr<MinimapTraceRecorder> recorder(new MinimapTraceRecorder);
+    recorder->m_file.setFileName(path);
+    if (!QDir().mkpath(dir) || !recorder->m_file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Minimap: cannot record a trace to" << path;
+        return nullptr;
+    }
+    QTextDocument *doc = editor->document();
+    recorder->m_stream.setDevice(&recorder->m_file);
+    recorder->m_stream << traceMagic << traceVersion << fileName
+                       << qCompress(doc->toPlainText().toUtf8()) << editor->size()
+                       << qint32(editor->verticalScrollBar()->value());
+    recorder->m_revision = doc->revision();
+    recorder->m_clock.start();
+    return recorder;
+}
+
+void MinimapTraceRecorder::contentsChange(const QTextDocument *doc,
+                                          int position,
+                                          int charsRemoved,
+                                          int charsAdded)
+{
+    // highlighters mark the contents dirty without a new revision
+    if (doc->revision() == m_revision) {
+        return;
+    }
+    m_revision = doc->revision();
+    QTextCursor cursor(const_cast<QTextDocument *>(doc));
+    cursor.setPosition(position);
+    cursor.setPosition(position + charsAdded, QTextCursor::KeepAnchor);
+    begin(Event::Edit) << qint32(position) << qint32(charsRemoved) << cursor.selectedText();
+}
+
+void MinimapTraceRecorder::scroll(int value)
+{
+    begin(Event::Scroll) << qint32(value) << qint32(0);
+}
+
+void MinimapTraceRecorder::mouse(const QMouseEvent *event)
+{
+    if (event->type() == QEvent::MouseButtonPress && event->button() == Qt::LeftButton) {
+        begin(Event::Press) << qint32(event->position().y()) << qint32(0);
+    } else if (event->type() == QEvent::MouseMove && event->buttons() & Qt::LeftButton) {
+        begin(Event::Move) << qint32(event->position().y()) << qint32(0);
+    } else if (event->type() == QEvent::MouseButtonRelease && event->button() == Qt::LeftButton) {
+        begin(Event::Release) << qint32(event->position().y()) << qint32(0);
+    }
+}
+
+void MinimapTraceRecorder::resize(const QSize &size)
+{
+    begin(Event::Resize) << qint32(size.width()) << qint32(size.height());
+}
+
+QDataStream &MinimapTraceRecorder::begin(Event event)
+{
+    m_stream << quint8(event) << quint32(m_clock.elapsed());
+    return m_stream;
+}
+
+void MinimapTraceReplay::startIfRequested()
+{
+    const QString path = qEnvironmentVariable(Constants::MINIMAP_TRACE_REPLAY_ENV);
+    if (path.isEmpty() || s_instance) {
+        return;
+    }
+    auto replay = new MinimapTraceReplay(path);
+    if (!replay->load()) {
+        qWarning() << "Minimap: cannot read the trace" << path;
+        delete replay;
+        return;
+    }
+    s_instance = replay;
+    QTimer::singleShot(0, replay, &MinimapTraceReplay::start);
+}
+
+void MinimapTraceReplay::addSample(const TextEditor::TextEditorWidget *editor,
+                                   Sample sample,
+                                   qint64 nsecs)
+{
+    if (s_instance && editor && s_instance->m_editor.data() == editor) {
+        s_instance->m_samples[static_cast<int>(sample)].append(nsecs);
+    }
+}
+
+MinimapTraceReplay::MinimapTraceReplay(const QString &tracePath)
+    : QObject(QCoreApplication::instance())
+    , m_tracePath(tracePath)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &MinimapTraceReplay::playNext);
+}
+
+MinimapTraceReplay::~MinimapTraceReplay()
+{
+    if (s_instance == this) {
+        s_instance = nullptr;
+    }
+}
+
+bool MinimapTraceReplay::load()
+{
+    QFile file(m_tracePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    quint32 magic(0);
+    quint32 version(0);
+    QByteArray text;
+    stream >> magic >> version;
+    if (magic != traceMagic || version != traceVersion) {
+        return false;
+    }
+    stream >> m_fileName >> text >> m_editorSize >> m_scrollValue;
+    m_text = QString::fromUtf8(qUncompress(text));
+
+    while (!stream.atEnd()) {
+        quint8 type(0);
+        TraceEvent event;
+        stream >> type >> event.time;
+        event.event = static_cast<MinimapTraceRecorder::Event>(type);
+        if (event.event == MinimapTraceRecorder::Event::Edit) {
+            stream >> event.a >> event.b >> event.text;
+        } else {
+            stream >> event.a >> event.b;
+        }
+        if (stream.status() != QDataStream::Ok) {
+            // a session that did not end cleanly leaves a truncated event
+            break;
+        }
+        m_events.append(event);
+    }
+    return true;
+}
+
+void MinimapTraceReplay::start()
+{
+    // replay on a copy, keeping the suffix so the same highlighter applies
+    const QString path = m_dir.filePath(m_fileName.isEmpty() ? QString("trace.txt") : m_fileName);
+    QFile file(path);
+    if (!m_dir.isValid() || !file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Minimap: cannot write the document of the trace to" << path;
+        deleteLater();
+        return;
+    }
+    file.write(m_text.toUtf8());
+    file.close();
+
+    auto editor = qobject_cast<TextEditor::BaseTextEditor *>(
+        Core::EditorManager::openEditor(Utils::FilePath::fromString(path)));
+    if (!editor) {
+        qWarning() << "Minimap: cannot open" << path;
+        deleteLater();
+        return;
+    }
+    m_editor = editor->editorWidget();
+    apply(TraceEvent{MinimapTraceRecorder::Event::Resize,
+                     0,
+                     m_editorSize.width(),
+                     m_editorSize.height(),
+                     QString()});
+    m_editor->verticalScrollBar()->setValue(m_scrollValue);
+    m_clock.start();
+    playNext();
+}
+
+void MinimapTraceReplay::playNext()
+{
+    if (!m_editor) {
+        deleteLater();
+        return;
+    }
+    while (m_next < m_events.size() && m_events.at(m_next).time <= m_clock.elapsed()) {
+        apply(m_events.at(m_next++));
+    }
+    if (m_next < m_events.size()) {
+        m_timer.start(static_cast<int>(m_events.at(m_next).time - m_clock.elapsed()));
+    } else {
+        QTimer::singleShot(replaySettleDelay, this, &MinimapTraceReplay::finish);
+    }
+}
+
+void MinimapTraceReplay::apply(const TraceEvent &event)
+{
+    QScrollBar *scrollbar = m_editor->verticalScrollBar();
+    const QPointF pos(scrollbar->width() / 2.0, event.a);
+    switch (event.event) {
+    case MinimapTraceRecorder::Event::Edit: {
+        QTextCursor cursor(m_editor->document());
+        cursor.setPosition(qMin(event.a, m_editor->document()->characterCount() - 1));
+        cursor.setPosition(qMin(event.a + event.b, m_editor->document()->characterCount() - 1),
+                           QTextCursor::KeepAnchor);
+        cursor.insertText(event.text);
+        break;
+    }
+    case MinimapTraceRecorder::Event::Scroll:
+        scrollbar->setValue(event.a);
+        break;
+    case MinimapTraceRecorder::Event::Press: {
+        QMouseEvent mouseEvent(QEvent::MouseButtonPress,
+                               pos,
+                               scrollbar->mapToGlobal(pos),
+                               Qt::LeftButton,
+                               Qt::LeftButton,
+                               Qt::NoModifier);
+        QCoreApplication::sendEvent(scrollbar, &mouseEvent);
+        break;
+    }
+    case MinimapTraceRecorder::Event::Move: {
+        QMouseEvent mouseEvent(QEvent::MouseMove,
+                               pos,
+                               scrollbar->mapToGlobal(pos),
+                               Qt::NoButton,
+                               Qt::LeftButton,
+                               Qt::NoModifier);
+        QCoreApplication::sendEvent(scrollbar, &mouseEvent);
+        break;
+    }
+    case MinimapTraceRecorder::Event::Release: {
+        QMouseEvent mouseEvent(QEvent::MouseButtonRelease,
+                               pos,
+                               scrollbar->mapToGlobal(pos),
+                               Qt::LeftButton,
+                               Qt::NoButton,
+                               Qt::NoModifier);
+        QCoreApplication::sendEvent(scrollbar, &mouseEvent);
+        break;
+    }
+    case MinimapTraceRecorder::Event::Resize: {
+        // the editor sits in a layout, so grow or shrink its window instead
+        QWidget *window = m_editor->window();
+        window->resize(window->size() + QSize(event.a, event.b) - m_editor->size());
+        break;
+    }
+    }
+}
+
+void MinimapTraceReplay::finish()
+{
+    const QString text = report();
+    qInfo().noquote() << text;
+    QFile file(m_tracePath + ".report");
+    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        file.write(text.toUtf8());
+    }
+    if (m_editor) {
+        Core::EditorManager::closeDocuments({m_editor->textDocument()}, false);
+    }
+    deleteLater();
+}
+
+QString MinimapTraceReplay::report() const
+{
+    QString text = QString("Minimap trace %1, %2 events\n").arg(m_tracePath).arg(m_events.size());
+    const char *names[] = {"paint", "update"};
+    for (int i = 0; i < 2; ++i) {
+        QList<qint64> sorted = m_samples[i];
+        std::sort(sorted.begin(), sorted.end());
+        text += QString("%1: n=%2 p50=%3ms p95=%4ms p99=%5ms\n")
+                    .arg(QLatin1String(names[i]))
+                    .arg(sorted.size())
+                    .arg(percentile(sorted, 50) / 1e6, 0, 'f', 3)
+                    .arg(percentile(sorted, 95) / 1e6, 0, 'f', 3)
+                    .arg(percentile(sorted, 99) / 1e6, 0, 'f', 3);
+    }
+    return text;
+}
+
+void MinimapTraceEvents::updateEnabled()
+{
+    const QString path = qEnvironmentVariable(Constants::MINIMAP_TRACE_EVENTS_ENV);
+    const bool enabled = !path.isEmpty() || MinimapSettings::traceEvents();
+    EventLog &log = eventLog();
+    QMutexLocker locker(&log.mutex);
+    if (enabled == log.file.isOpen()) {
+        return;
+    }
+    if (enabled) {
+        const QString dir = Core::ICore::userResourcePath("minimap").toFSPathString();
+        log.file.setFileName(
+            !path.isEmpty()
+                ? path
+                : QDir(dir).filePath(
+                      QString("trace-%1.json").arg(QCoreApplication::applicationPid())));
+        QDir().mkpath(QFileInfo(log.file.fileName()).absolutePath());
+        if (log.file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            log.buffer = "[";
+            log.empty = true;
+        } else {
+            qWarning() << "Minimap: cannot write trace events to" << log.file.fileName();
+        }
+    } else {
+        closeEventLog(log);
+    }
+    s_enabled.store(log.file.isOpen(), std::memory_order_relaxed);
+}
+
+void MinimapTraceEvents::shutdown()
+{
+    EventLog &log = eventLog();
+    QMutexLocker locker(&log.mutex);
+    s_enabled.store(false, std::memory_order_relaxed);
+    closeEventLog(log);
+}
+
+void MinimapTraceEvents::write(char phase, const char *name, qint64 blocks, qint64 pixels)
+{
+    using namespace std::chrono;
+    const qint64 ts = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    const qint64 tid = static_cast<qint64>(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+
+    EventLog &log = eventLog();
+    QMutexLocker locker(&log.mutex);
+    if (!log.file.isOpen()) {
+        return;
+    }
+    QByteArray &b = log.buffer;
+    if (!log.empty) {
+        b += ",";
+    }
+    log.empty = false;
+    b += "\n{\"name\":\"";
+    b += name;
+    b += "\",\"cat\":\"minimap\",\"ph\":\"";
+    b += phase;
+    b += "\",\"ts\":";
+    b += QByteArray::number(ts);
+    b += ",\"pid\":";
+    b += QByteArray::number(QCoreApplication::applicationPid());
+    b += ",\"tid\":";
+    b += QByteArray::number(tid);
+    if (blocks >= 0 || pixels >= 0) {
+        b += ",\"args\":{";
+        if (blocks >= 0) {
+            b += "\"blocks\":";
+            b += QByteArray::number(blocks);
+        }
+        if (pixels >= 0) {
+            b += blocks >= 0 ? ",\"pixels\":" : "\"pixels\":";
+            b += QByteArray::number(pixels);
+        }
+        b += "}";
+    }
+    b += "}";
+    if (b.size() > eventFlushSize) {
+        log.file.write(b);
+        b.clear();
+    }
+}
+} // namespace Internal
+} // namespace Minimap
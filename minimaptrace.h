@@ -0,0 +1,187 @@
+/*
+  Minimap QtCreator plugin.
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not see
+  http://www.gnu.org/licenses/lgpl-2.1.html.
+
+  Copyright (c) 2017, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+#pragma once
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSize>
+#include <QString>
+#include <QTemporaryDir>
+#include <QTimer>
+
+#include <atomic>
+#include <memory>
+
+class QMouseEvent;
+class QTextDocument;
+
+namespace TextEditor {
+class TextEditorWidget;
+}
+
+namespace Minimap {
+namespace Internal {
+
+//! Records the interactions with an editor that drive its minimap, so they
+//! can be played back by MinimapTraceReplay.
+//!
+//! Recording is enabled by pointing the QTC_MINIMAP_TRACE_RECORD environment
+//! variable to a directory. Every editor then writes a trace holding the
+//! initial text of its document followed by the edits, scrollbar values,
+//! mouse drags on the minimap and editor resizes, each stamped with the
+//! time it happened at.
+class MinimapTraceRecorder
+{
+public:
+    enum class Event : quint8 { Edit, Scroll, Press, Move, Release, Resize };
+
+    //! Returns a recorder for @a editor if recording is enabled.
+    static std::unique_ptr<MinimapTraceRecorder> create(TextEditor::TextEditorWidget *editor);
+
+    //! Follows QTextDocument::contentsChange, ignoring format only changes.
+    void contentsChange(const QTextDocument *doc, int position, int charsRemoved, int charsAdded);
+    void scroll(int value);
+    void mouse(const QMouseEvent *event);
+    void resize(const QSize &size);
+
+private:
+    MinimapTraceRecorder() = default;
+    QDataStream &begin(Event event);
+
+    QFile m_file;
+    QDataStream m_stream;
+    QElapsedTimer m_clock;
+    int m_revision = 0;
+};
+
+//! Plays a recorded trace back against a real editor and reports the
+//! percentiles of the paint and update latencies of its minimap.
+//!
+//! Playback is enabled by pointing the QTC_MINIMAP_TRACE_REPLAY environment
+//! variable to a trace file. The report is logged and written next to the
+//! trace, with ".report" appended to its name.
+class MinimapTraceReplay : public QObject
+{
+public:
+    enum class Sample { Paint, Update };
+
+    static void startIfRequested();
+    static bool isActive() { return s_instance != nullptr; }
+    //! Records a latency of the minimap of @a editor, samples of the other
+    //! editors that are open during the playback are dropped.
+    static void addSample(const TextEditor::TextEditorWidget *editor, Sample sample, qint64 nsecs);
+
+private:
+    struct TraceEvent
+    {
+        MinimapTraceRecorder::Event event;
+        quint32 time; // ms
+        qint32 a;
+        qint32 b;
+        QString text;
+    };
+
+    explicit MinimapTraceReplay(const QString &tracePath);
+    ~MinimapTraceReplay();
+
+    bool load();
+    void start();
+    void playNext();
+    void apply(const TraceEvent &event);
+    void finish();
+    QString report() const;
+
+    static MinimapTraceReplay *s_instance;
+
+    QString m_tracePath;
+    QString m_fileName;
+    QString m_text;
+    QSize m_editorSize;
+    qint32 m_scrollValue = 0;
+    QList<TraceEvent> m_events;
+    int m_next = 0;
+    QTemporaryDir m_dir;
+    QPointer<TextEditor::TextEditorWidget> m_editor;
+    QElapsedTimer m_clock;
+    QTimer m_timer;
+    QList<qint64> m_samples[2];
+};
+
+//! Writes Chrome trace events of the minimap's work to a JSON file that can
+//! be loaded into chrome://tracing or Perfetto.
+//!
+//! Tracing is off unless the QTC_MINIMAP_TRACE_EVENTS environment variable
+//! names the file to write or the trace events setting is on, in which case
+//! the file is created in the minimap directory of the user resources.
+//! Timestamps come from the monotonic clock, so the events line up with
+//! traces of other tools.
+class MinimapTraceEvents
+{
+public:
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    //! Opens or closes the trace file to follow the environment and settings.
+    static void updateEnabled();
+    static void shutdown();
+
+    //! Writes one event of phase @a phase. Negative counts are left out.
+    static void write(char phase, const char *name, qint64 blocks = -1, qint64 pixels = -1);
+
+private:
+    static std::atomic_bool s_enabled;
+};
+
+//! Writes a begin event on construction and the matching end event, with
+//! the block and pixel counts set meanwhile, on destruction.
+class MinimapTraceScope
+{
+public:
+    explicit MinimapTraceScope(const char *name)
+        : m_name(name)
+        , m_enabled(MinimapTraceEvents::isEnabled())
+    {
+        if (m_enabled) {
+            MinimapTraceEvents::write('B', m_name);
+        }
+    }
+
+    ~MinimapTraceScope()
+    {
+        if (m_enabled) {
+            MinimapTraceEvents::write('E', m_name, m_blocks, m_pixels);
+        }
+    }
+
+    void setBlocks(qint64 blocks) { m_blocks = blocks; }
+    void setPixels(qint64 pixels) { m_pixels = pixels; }
+
+private:
+    const char *m_name;
+    bool m_enabled;
+    qint64 m_blocks = -1;
+    qint64 m_pixels = -1;
+};
+} // namespace Internal
+} // namespace Minimap